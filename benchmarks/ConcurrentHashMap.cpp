@@ -0,0 +1,134 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+
+// Measures how ConcurrentHashMap scales with the number of threads, against a single HashMap behind one Mutex.
+// Every thread runs the same mix of operations on random keys from a shared key space:
+// 80% get, 15% set, 5% unset. The map is pre-filled with half of the key space.
+//
+// Usage: benchmark-ConcurrentHashMap [maxThreads] [opsPerThread]   (defaults: 16, 1000000)
+
+#include <littl/ConcurrentHashMap.hpp>
+#include <littl/PerfTiming.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace li;
+
+static const uint32_t numKeys = 1 << 20;
+
+static std::atomic<uint64_t> sink;
+
+class LockedHashMap
+{
+    Mutex mutex;
+    HashMap<uint32_t, uint32_t> map;
+
+    public:
+        uint32_t get( uint32_t key )
+        {
+            CriticalSection cs( mutex );
+            return map.get( key );
+        }
+
+        void set( uint32_t key, uint32_t value )
+        {
+            CriticalSection cs( mutex );
+            map.set( uint32_t( key ), uint32_t( value ) );
+        }
+
+        void unset( uint32_t key )
+        {
+            CriticalSection cs( mutex );
+            map.unset( key );
+        }
+};
+
+template <class Map>
+static void worker( Map& map, unsigned seed, uint32_t numOps )
+{
+    uint32_t state = seed * 2654435761u + 1;
+    uint64_t sum = 0;
+
+    for ( uint32_t i = 0; i < numOps; i++ )
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        uint32_t key = state & ( numKeys - 1 );
+        uint32_t op = ( state >> 20 ) % 100;
+
+        if ( op < 80 )
+            sum += map.get( key );
+        else if ( op < 95 )
+            map.set( key, i );
+        else
+            map.unset( key );
+    }
+
+    sink += sum;
+}
+
+template <class Map>
+static void run( const char* name, unsigned numThreads, uint32_t opsPerThread )
+{
+    Map map;
+
+    for ( uint32_t key = 0; key < numKeys; key += 2 )
+        map.set( uint32_t( key ), uint32_t( key ) );
+
+    PerfTimer timer;
+    uint64_t start = timer.getCurrentMicros();
+
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < numThreads; i++ )
+        threads.emplace_back( worker<Map>, std::ref( map ), i, opsPerThread );
+
+    for ( auto& thread : threads )
+        thread.join();
+
+    uint64_t elapsed = timer.getCurrentMicros() - start;
+
+    printf( "%-20s %3u threads: %9.2f ms, %8.2f Mops/s\n", name, numThreads,
+            elapsed / 1000.0, double( numThreads ) * opsPerThread / elapsed );
+}
+
+int main( int argc, char** argv )
+{
+    unsigned maxThreads = ( argc > 1 ) ? static_cast<unsigned>( strtoul( argv[1], nullptr, 0 ) ) : 16;
+    uint32_t opsPerThread = ( argc > 2 ) ? static_cast<uint32_t>( strtoul( argv[2], nullptr, 0 ) ) : 1000000;
+
+    for ( unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        run<LockedHashMap>( "HashMap + Mutex", numThreads, opsPerThread );
+        run<ConcurrentHashMap<uint32_t, uint32_t>>( "ConcurrentHashMap", numThreads, opsPerThread );
+        printf( "\n" );
+    }
+}
@@ -0,0 +1,111 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+// Compares FlatHashMap with the chained HashMap (and std::unordered_map for reference):
+// inserting N sequential integer keys, then looking all of them up plus N missing keys.
+//
+// Usage: benchmark-FlatHashMap [maxEntries]   (default 10000000)
+//
+// Note that std::hash of an integer is the identity, which makes sequential keys a best case for unordered_map.
+
+#include <littl/FlatHashMap.hpp>
+#include <littl/HashMap.hpp>
+#include <littl/PerfTiming.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+using namespace li;
+
+static volatile uint64_t sink;
+
+template <class Map>
+static void runLi( const char* name, uint32_t numEntries )
+{
+    PerfTimer timer;
+    uint64_t start = timer.getCurrentMicros();
+
+    Map map;
+
+    for ( uint32_t i = 0; i < numEntries; i++ )
+        map.set( uint32_t( i ), uint32_t( i ) );
+
+    uint64_t inserted = timer.getCurrentMicros();
+    uint64_t sum = 0;
+
+    for ( uint32_t i = 0; i < numEntries * 2; i++ )
+    {
+        uint32_t* value = map.find( i );
+
+        if ( value != nullptr )
+            sum += *value;
+    }
+
+    uint64_t looked = timer.getCurrentMicros();
+    sink = sum;
+
+    printf( "%-20s %10u entries: insert %9.2f ms, lookup %9.2f ms, total %9.2f ms\n", name, numEntries,
+            ( inserted - start ) / 1000.0, ( looked - inserted ) / 1000.0, ( looked - start ) / 1000.0 );
+}
+
+static void runStd( uint32_t numEntries )
+{
+    PerfTimer timer;
+    uint64_t start = timer.getCurrentMicros();
+
+    std::unordered_map<uint32_t, uint32_t> map;
+
+    for ( uint32_t i = 0; i < numEntries; i++ )
+        map[i] = i;
+
+    uint64_t inserted = timer.getCurrentMicros();
+    uint64_t sum = 0;
+
+    for ( uint32_t i = 0; i < numEntries * 2; i++ )
+    {
+        auto it = map.find( i );
+
+        if ( it != map.end() )
+            sum += it->second;
+    }
+
+    uint64_t looked = timer.getCurrentMicros();
+    sink = sum;
+
+    printf( "%-20s %10u entries: insert %9.2f ms, lookup %9.2f ms, total %9.2f ms\n", "std::unordered_map", numEntries,
+            ( inserted - start ) / 1000.0, ( looked - inserted ) / 1000.0, ( looked - start ) / 1000.0 );
+}
+
+int main( int argc, char** argv )
+{
+    uint32_t maxEntries = ( argc > 1 ) ? static_cast<uint32_t>( strtoul( argv[1], nullptr, 0 ) ) : 10000000;
+
+    for ( uint32_t numEntries = 1000; numEntries <= maxEntries; numEntries *= 10 )
+    {
+        runLi<HashMap<uint32_t, uint32_t>>( "HashMap", numEntries );
+        runLi<FlatHashMap<uint32_t, uint32_t>>( "FlatHashMap", numEntries );
+        runStd( numEntries );
+        printf( "\n" );
+    }
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+
+// Lock contention across thread counts: every thread repeatedly takes the lock, does a little work on shared
+// state and releases it, with a short pause outside the lock. Compares Mutex (recursive), FastMutex, SpinLock,
+// RWLock taken exclusively, and RWLock in a read-mostly mix (1 in 10 acquisitions exclusive).
+//
+// Usage: benchmark-Locks [maxThreads] [opsPerThread]   (defaults: 16, 200000)
+
+#include <littl/PerfTiming.hpp>
+#include <littl/Thread.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace li;
+
+enum { exclusive, readMostly };
+
+struct SharedState
+{
+    uint64_t counter;
+    uint64_t values[7];
+};
+
+static inline void work( uint32_t& state )
+{
+    // Stands in for the non-critical part of a real thread's loop
+    for ( int i = 0; i < 20; i++ )
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+    }
+}
+
+template <class Lock, int mode>
+static void worker( Lock& lock, SharedState& shared, unsigned seed, uint32_t numOps, volatile uint64_t& sink )
+{
+    uint32_t state = seed * 2654435761u + 1;
+    uint64_t sum = 0;
+
+    for ( uint32_t i = 0; i < numOps; i++ )
+    {
+        work( state );
+
+        if constexpr ( mode == readMostly )
+        {
+            if ( i % 10 != 0 )
+            {
+                SharedScopedLock<Lock> sl( lock );
+                sum += shared.counter + shared.values[state % 7];
+                continue;
+            }
+        }
+
+        ScopedLock<Lock> sl( lock );
+        shared.counter++;
+        shared.values[state % 7] += state;
+    }
+
+    sink = sum;
+}
+
+template <class Lock, int mode>
+static void run( const char* name, unsigned numThreads, uint32_t opsPerThread )
+{
+    Lock lock;
+    SharedState shared = {};
+    std::vector<uint64_t> sinks( numThreads * 8 );
+
+    PerfTimer timer;
+    uint64_t start = timer.getCurrentMicros();
+
+    std::vector<std::thread> threads;
+
+    for ( unsigned i = 0; i < numThreads; i++ )
+        threads.emplace_back( [&, i] { worker<Lock, mode>( lock, shared, i, opsPerThread, sinks[i * 8] ); } );
+
+    for ( auto& thread : threads )
+        thread.join();
+
+    uint64_t elapsed = timer.getCurrentMicros() - start;
+
+    const uint64_t expected = ( mode == readMostly ) ? uint64_t( numThreads ) * ( ( opsPerThread + 9 ) / 10 )
+            : uint64_t( numThreads ) * opsPerThread;
+
+    printf( "%-20s %3u threads: %9.2f ms, %8.2f Mops/s, %7.1f ns/op%s\n", name, numThreads, elapsed / 1000.0,
+            double( numThreads ) * opsPerThread / elapsed, elapsed * 1000.0 / ( double( numThreads ) * opsPerThread ),
+            ( shared.counter == expected ) ? "" : "  COUNTER MISMATCH" );
+}
+
+int main( int argc, char** argv )
+{
+    unsigned maxThreads = ( argc > 1 ) ? static_cast<unsigned>( strtoul( argv[1], nullptr, 0 ) ) : 16;
+    uint32_t opsPerThread = ( argc > 2 ) ? static_cast<uint32_t>( strtoul( argv[2], nullptr, 0 ) ) : 200000;
+
+    for ( unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        run<Mutex, exclusive>( "Mutex", numThreads, opsPerThread );
+        run<FastMutex, exclusive>( "FastMutex", numThreads, opsPerThread );
+        run<SpinLock, exclusive>( "SpinLock", numThreads, opsPerThread );
+        run<RWLock, exclusive>( "RWLock", numThreads, opsPerThread );
+        run<RWLock, readMostly>( "RWLock (90% shared)", numThreads, opsPerThread );
+        printf( "\n" );
+    }
+}
@@ -0,0 +1,223 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+
+// Checks String::getHash on realistic key sets: counts full-width collisions and measures how evenly
+// the low bits (which HashMap uses to pick a bucket) spread the keys over power-of-two tables.
+//
+// Usage: benchmark-StringHash [keyFile...]
+//
+// Besides the built-in synthetic sets, every keyFile is hashed as one set with one key per line
+// (e.g. /usr/share/dict/words). Exits with status 1 if any set has a collision or a badly skewed distribution.
+
+#include <littl/String.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace li;
+
+// Chi-squared statistic of the bucket counts, normalised so that a uniform hash scores around +-1
+static double getDistributionScore( const std::vector<size_t>& hashes, unsigned bits, size_t& maxLoad_out )
+{
+    const size_t numBuckets = size_t( 1 ) << bits;
+    std::vector<size_t> counts( numBuckets );
+
+    for ( size_t hash : hashes )
+        counts[hash & ( numBuckets - 1 )]++;
+
+    const double expected = double( hashes.size() ) / numBuckets;
+    double chiSquared = 0.0;
+
+    for ( size_t count : counts )
+        chiSquared += ( count - expected ) * ( count - expected ) / expected;
+
+    maxLoad_out = *std::max_element( counts.begin(), counts.end() );
+    return ( chiSquared - ( numBuckets - 1 ) ) / std::sqrt( 2.0 * ( numBuckets - 1 ) );
+}
+
+static bool check( const char* name, const std::vector<std::string>& keys )
+{
+    std::vector<size_t> hashes;
+    hashes.reserve( keys.size() );
+
+    for ( const auto& key : keys )
+        hashes.push_back( String( key.c_str(), key.size() ).getHash() );
+
+    std::vector<size_t> sorted( hashes );
+    std::sort( sorted.begin(), sorted.end() );
+    const size_t numCollisions = sorted.size() - ( std::unique( sorted.begin(), sorted.end() ) - sorted.begin() );
+
+    printf( "%-24s %8zu keys, %zu collisions\n", name, keys.size(), numCollisions );
+
+    bool ok = ( numCollisions == 0 );
+
+    for ( unsigned bits = 8; bits <= 16; bits += 4 )
+    {
+        // Need a handful of keys per bucket for the statistic to mean anything
+        if ( keys.size() < ( size_t( 5 ) << bits ) )
+            continue;
+
+        size_t maxLoad;
+        const double score = getDistributionScore( hashes, bits, maxLoad );
+
+        printf( "    %6zu buckets: %7.2f keys/bucket, max %4zu, chi-squared score %+6.2f\n", size_t( 1 ) << bits,
+                double( keys.size() ) / ( size_t( 1 ) << bits ), maxLoad, score );
+
+        if ( score > 6.0 )
+            ok = false;
+    }
+
+    if ( !ok )
+        printf( "    FAILED\n" );
+
+    return ok;
+}
+
+int main( int argc, char** argv )
+{
+    bool ok = true;
+    char buffer[256];
+
+    std::vector<std::string> keys;
+
+    for ( unsigned i = 0; i < 500000; i++ )
+    {
+        snprintf( buffer, sizeof( buffer ), "%u", i );
+        keys.push_back( buffer );
+    }
+
+    ok = check( "decimal numbers", keys ) && ok;
+
+    keys.clear();
+
+    for ( unsigned i = 0; i < 500000; i++ )
+    {
+        snprintf( buffer, sizeof( buffer ), "user_%06u", i );
+        keys.push_back( buffer );
+    }
+
+    ok = check( "identifiers", keys ) && ok;
+
+    keys.clear();
+
+    static const char* const dirs[] = { "/usr/lib/", "/usr/include/", "/home/user/src/", "/var/log/" };
+    static const char* const exts[] = { ".so", ".h", ".cpp", ".log", ".txt" };
+
+    for ( unsigned i = 0; i < 100000; i++ )
+        for ( const char* ext : exts )
+        {
+            snprintf( buffer, sizeof( buffer ), "%sfile%u%s", dirs[i % 4], i, ext );
+            keys.push_back( buffer );
+        }
+
+    ok = check( "file paths", keys ) && ok;
+
+    keys.clear();
+
+    for ( unsigned i = 0; i < 300000; i++ )
+    {
+        snprintf( buffer, sizeof( buffer ), "https://example.com/articles/%u/comments?page=%u", i / 10, i % 10 );
+        keys.push_back( buffer );
+    }
+
+    ok = check( "URLs", keys ) && ok;
+
+    keys.clear();
+
+    // Every string of 1 to 3 lowercase letters -- short keys are the hardest case for a byte hash
+    for ( unsigned length = 1; length <= 3; length++ )
+    {
+        unsigned count = 1;
+
+        for ( unsigned i = 0; i < length; i++ )
+            count *= 26;
+
+        for ( unsigned i = 0; i < count; i++ )
+        {
+            std::string key;
+
+            for ( unsigned j = 0, n = i; j < length; j++, n /= 26 )
+                key += char( 'a' + n % 26 );
+
+            keys.push_back( key );
+        }
+    }
+
+    ok = check( "short words", keys ) && ok;
+
+    keys.clear();
+
+    // Two-byte UTF-8 characters (Cyrillic) in three-character words
+    for ( unsigned i = 0; i < 32 * 32 * 32; i++ )
+    {
+        std::string key;
+
+        for ( unsigned j = 0, n = i; j < 3; j++, n /= 32 )
+        {
+            const unsigned codePoint = 0x430 + n % 32;
+            key += char( 0xC0 | ( codePoint >> 6 ) );
+            key += char( 0x80 | ( codePoint & 0x3F ) );
+        }
+
+        keys.push_back( key );
+    }
+
+    ok = check( "UTF-8 words", keys ) && ok;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        FILE* file = fopen( argv[i], "rb" );
+
+        if ( file == nullptr )
+        {
+            fprintf( stderr, "cannot open %s\n", argv[i] );
+            return 2;
+        }
+
+        keys.clear();
+
+        while ( fgets( buffer, sizeof( buffer ), file ) != nullptr )
+        {
+            std::string key( buffer );
+
+            while ( !key.empty() && ( key.back() == '\n' || key.back() == '\r' ) )
+                key.pop_back();
+
+            keys.push_back( key );
+        }
+
+        fclose( file );
+
+        // Key files may contain duplicates, which would count as collisions
+        std::sort( keys.begin(), keys.end() );
+        keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+        ok = check( argv[i], keys ) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -48,7 +48,7 @@ namespace li
     }
 
     HttpSession::HttpSession( const char* host )
-            : host( host ), currentRequest( 0 ), bufferSize( 0x1000 )
+            : host( host ), currentRequest( 0 ), queueHead( 0 ), bufferSize( 0x1000 )
     {
     }
 
@@ -56,10 +56,11 @@ namespace li
     {
         enter();
 
-        for ( auto request : queue )
-            request->changeStatus( HttpRequest::aborted );
+        for ( size_t i = queueHead; i < queue.getLength(); i++ )
+            queue[i]->changeStatus( HttpRequest::aborted );
 
-        queue.clear();
+        queue.clear( true );
+        queueHead = 0;
 
         leave();
     }
@@ -107,10 +108,21 @@ namespace li
             if ( !currentRequest )
             {
                 enter();
-                if ( !queue.isEmpty() )
+                if ( queueHead < queue.getLength() )
                 {
-                    currentRequest = queue[0];
-                    queue.remove( 0 );
+                    currentRequest = queue[queueHead++];
+
+                    // Compact once half of the list has been consumed, so dequeuing is amortized O(1)
+                    if ( queueHead == queue.getLength() )
+                    {
+                        queue.clear( true );
+                        queueHead = 0;
+                    }
+                    else if ( queueHead * 2 >= queue.getLength() )
+                    {
+                        queue.remove( 0, queueHead );
+                        queueHead = 0;
+                    }
                 }
                 leave();
 
@@ -172,7 +184,7 @@ namespace li
 
                 if ( responseLine.beginsWith( "HTTP" ) )
                 {
-                    List<String> tokens;
+                    List<StringView> tokens;
                     responseLine.parse( tokens, ' ' );
 
                     if ( !tokens[1].beginsWith( '2' ) )
@@ -183,7 +195,7 @@ namespace li
                 }
                 else if ( responseLine.beginsWith( "Content-Length: " ) )
                 {
-                    List<String> tokens;
+                    List<StringView> tokens;
                     responseLine.parse( tokens, ' ' );
 
                     dataLength = tokens[1].toUnsigned();
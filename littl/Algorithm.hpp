@@ -24,6 +24,16 @@
 
 #include <littl/Base.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// Sorting, searching and folding over contiguous storage.
+// Every algorithm takes a (pointer, count) range; the container overloads accept anything
+// with getPtrUnsafe() and getLength() (List, and your own types), so no copying to std::vector is needed.
+
 namespace li
 {
     template<size_t alignment, typename Type>
@@ -33,4 +43,476 @@ namespace li
 
         return (value + alignment - 1) & ~(alignment - 1);
     }
+
+    struct Less
+    {
+        template <typename A, typename B>
+        bool operator()( const A& a, const B& b ) const { return a < b; }
+    };
+
+    namespace AlgorithmDetail
+    {
+        enum { insertionSortThreshold = 16, mergeRunLength = 32 };
+
+        template <typename T, class Compare>
+        void insertionSort( T* first, T* last, Compare& less )
+        {
+            for ( T* i = first + 1; i < last; i++ )
+            {
+                if ( !less( *i, *( i - 1 ) ) )
+                    continue;
+
+                T value = std::move( *i );
+                T* j = i;
+
+                do
+                {
+                    *j = std::move( *( j - 1 ) );
+                    j--;
+                }
+                while ( j > first && less( value, *( j - 1 ) ) );
+
+                *j = std::move( value );
+            }
+        }
+
+        template <typename T, class Compare>
+        void siftDown( T* heap, size_t root, size_t count, Compare& less )
+        {
+            T value = std::move( heap[root] );
+
+            for ( size_t child; ( child = 2 * root + 1 ) < count; root = child )
+            {
+                if ( child + 1 < count && less( heap[child], heap[child + 1] ) )
+                    child++;
+
+                if ( !less( value, heap[child] ) )
+                    break;
+
+                heap[root] = std::move( heap[child] );
+            }
+
+            heap[root] = std::move( value );
+        }
+
+        template <typename T, class Compare>
+        void heapSort( T* first, T* last, Compare& less )
+        {
+            size_t count = last - first;
+
+            for ( size_t i = count / 2; i-- > 0; )
+                siftDown( first, i, count, less );
+
+            while ( count > 1 )
+            {
+                count--;
+                std::swap( first[0], first[count] );
+                siftDown( first, 0, count, less );
+            }
+        }
+
+        template <typename T, class Compare>
+        void moveMedianToFirst( T* result, T* a, T* b, T* c, Compare& less )
+        {
+            if ( less( *a, *b ) )
+            {
+                if ( less( *b, *c ) )       std::swap( *result, *b );
+                else if ( less( *a, *c ) )  std::swap( *result, *c );
+                else                        std::swap( *result, *a );
+            }
+            else if ( less( *a, *c ) )      std::swap( *result, *a );
+            else if ( less( *b, *c ) )      std::swap( *result, *c );
+            else                            std::swap( *result, *b );
+        }
+
+        // Hoare partition around *pivot; the median-of-three guarantees sentinels on both sides
+        template <typename T, class Compare>
+        T* unguardedPartition( T* first, T* last, T* pivot, Compare& less )
+        {
+            for ( ;; )
+            {
+                while ( less( *first, *pivot ) )
+                    first++;
+
+                last--;
+
+                while ( less( *pivot, *last ) )
+                    last--;
+
+                if ( !( first < last ) )
+                    return first;
+
+                std::swap( *first, *last );
+                first++;
+            }
+        }
+
+        template <typename T, class Compare>
+        void introsortLoop( T* first, T* last, unsigned depthLimit, Compare& less )
+        {
+            while ( last - first > insertionSortThreshold )
+            {
+                if ( depthLimit == 0 )
+                {
+                    heapSort( first, last, less );
+                    return;
+                }
+
+                depthLimit--;
+
+                moveMedianToFirst( first, first + 1, first + ( last - first ) / 2, last - 1, less );
+                T* cut = unguardedPartition( first + 1, last, first, less );
+
+                // Recurse into the smaller half so the stack stays O(log n)
+                if ( cut - first < last - cut )
+                {
+                    introsortLoop( first, cut, depthLimit, less );
+                    first = cut;
+                }
+                else
+                {
+                    introsortLoop( cut, last, depthLimit, less );
+                    last = cut;
+                }
+            }
+
+            insertionSort( first, last, less );
+        }
+
+        inline unsigned log2( size_t value )
+        {
+            unsigned result = 0;
+
+            while ( value >>= 1 )
+                result++;
+
+            return result;
+        }
+
+        // Stable merge of two sorted runs into `out` (ties taken from `a`)
+        template <typename T, class Compare>
+        T* merge( T* a, T* aEnd, T* b, T* bEnd, T* out, Compare& less )
+        {
+            while ( a < aEnd && b < bEnd )
+            {
+                if ( less( *b, *a ) )
+                    *out++ = std::move( *b++ );
+                else
+                    *out++ = std::move( *a++ );
+            }
+
+            while ( a < aEnd )
+                *out++ = std::move( *a++ );
+
+            while ( b < bEnd )
+                *out++ = std::move( *b++ );
+
+            return out;
+        }
+
+        // Number of items merge() takes from `a` to produce the first `k` outputs
+        template <typename T, class Compare>
+        size_t mergeSplit( const T* a, size_t na, const T* b, size_t nb, size_t k, Compare& less )
+        {
+            size_t lo = ( k > nb ) ? k - nb : 0;
+            size_t hi = ( k < na ) ? k : na;
+
+            while ( lo < hi )
+            {
+                size_t i = lo + ( hi - lo ) / 2;
+                size_t j = k - i;
+
+                if ( !less( b[j - 1], a[i] ) )
+                    lo = i + 1;
+                else
+                    hi = i;
+            }
+
+            return lo;
+        }
+
+        template <typename T, class Compare>
+        void mergeSort( T* data, size_t count, T* buffer, Compare& less )
+        {
+            for ( size_t i = 0; i < count; i += mergeRunLength )
+                insertionSort( data + i, data + ( ( count - i > mergeRunLength ) ? i + mergeRunLength : count ), less );
+
+            T* src = data;
+            T* dst = buffer;
+
+            for ( size_t width = mergeRunLength; width < count; width *= 2 )
+            {
+                for ( size_t i = 0; i < count; i += 2 * width )
+                {
+                    size_t mid = ( count - i > width ) ? i + width : count;
+                    size_t end = ( count - mid > width ) ? mid + width : count;
+
+                    merge( src + i, src + mid, src + mid, src + end, dst + i, less );
+                }
+
+                std::swap( src, dst );
+            }
+
+            if ( src != data )
+                for ( size_t i = 0; i < count; i++ )
+                    data[i] = std::move( src[i] );
+        }
+
+        // Order-preserving mapping of radix-sortable keys onto unsigned integers
+        template <typename T, typename Enable = void>
+        struct RadixKey;
+
+        template <typename T>
+        struct RadixKey<T, typename std::enable_if<std::is_integral<T>::value>::type>
+        {
+            typedef typename std::make_unsigned<T>::type Type;
+
+            static Type get( T value )
+            {
+                if ( std::is_signed<T>::value )
+                    return static_cast<Type>( value ) ^ ( static_cast<Type>( 1 ) << ( sizeof( T ) * 8 - 1 ) );
+                else
+                    return static_cast<Type>( value );
+            }
+        };
+
+        template <typename T>
+        struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+        {
+            static_assert( sizeof( T ) == 4 || sizeof( T ) == 8, "unsupported floating-point type" );
+
+            typedef typename std::conditional<sizeof( T ) == 4, uint32_t, uint64_t>::type Type;
+
+            static Type get( T value )
+            {
+                static const Type signBit = static_cast<Type>( 1 ) << ( sizeof( T ) * 8 - 1 );
+
+                Type bits;
+                memcpy( &bits, &value, sizeof( bits ) );
+
+                // Negative numbers are flipped entirely so that they order in reverse
+                return ( bits & signBit ) ? ~bits : ( bits | signBit );
+            }
+        };
+
+        enum { radixBits = 8, radixSize = 1 << radixBits };
+
+        template <typename T>
+        unsigned radixDigit( T value, unsigned pass )
+        {
+            return static_cast<unsigned>( ( RadixKey<T>::get( value ) >> ( pass * radixBits ) ) & ( radixSize - 1 ) );
+        }
+
+        // Counts every digit of every key in a single read of the data
+        template <typename T>
+        void radixHistograms( const T* data, size_t count, size_t ( *histograms )[radixSize] )
+        {
+            for ( size_t i = 0; i < count; i++ )
+            {
+                auto key = RadixKey<T>::get( data[i] );
+
+                for ( unsigned pass = 0; pass < sizeof( T ); pass++ )
+                    histograms[pass][( key >> ( pass * radixBits ) ) & ( radixSize - 1 )]++;
+            }
+        }
+    }
+
+    // Unstable in-place sort (introsort: median-of-three quicksort, falling back to heapsort on bad pivots,
+    // finishing small partitions with insertion sort).
+    template <typename T, class Compare = Less>
+    void sort( T* data, size_t count, Compare less = Compare() )
+    {
+        if ( count > 1 )
+            AlgorithmDetail::introsortLoop( data, data + count, 2 * AlgorithmDetail::log2( count ), less );
+    }
+
+    // Stable merge sort. `buffer` must hold `count` items; one is allocated if not provided.
+    template <typename T, class Compare = Less>
+    void stableSort( T* data, size_t count, Compare less = Compare(), T* buffer = nullptr )
+    {
+        if ( count <= AlgorithmDetail::mergeRunLength )
+        {
+            if ( count > 1 )
+                AlgorithmDetail::insertionSort( data, data + count, less );
+
+            return;
+        }
+
+        T* ownBuffer = nullptr;
+
+        if ( buffer == nullptr )
+            buffer = ownBuffer = new T[count];
+
+        AlgorithmDetail::mergeSort( data, count, buffer, less );
+
+        delete[] ownBuffer;
+    }
+
+    // Stable LSD radix sort of integers or floats, 8 bits per pass. Passes in which every key has the same digit
+    // are skipped, so narrow value ranges cost only a fraction of the full sizeof( T ) passes.
+    // `scratch` must hold `count` items; one is allocated if not provided.
+    template <typename T>
+    void radixSort( T* data, size_t count, T* scratch = nullptr )
+    {
+        using namespace AlgorithmDetail;
+
+        static_assert( std::is_integral<T>::value || std::is_floating_point<T>::value, "radixSort requires integer or floating-point keys" );
+
+        if ( count < radixSize )
+        {
+            sort( data, count, [] ( T a, T b ) { return RadixKey<T>::get( a ) < RadixKey<T>::get( b ); } );
+            return;
+        }
+
+        size_t histograms[sizeof( T )][radixSize] = {};
+        radixHistograms( data, count, histograms );
+
+        T* ownScratch = nullptr;
+
+        if ( scratch == nullptr )
+            scratch = ownScratch = new T[count];
+
+        T* src = data;
+        T* dst = scratch;
+
+        for ( unsigned pass = 0; pass < sizeof( T ); pass++ )
+        {
+            size_t* offsets = histograms[pass];
+
+            if ( offsets[radixDigit( src[0], pass )] == count )
+                continue;
+
+            size_t sum = 0;
+
+            for ( unsigned digit = 0; digit < radixSize; digit++ )
+            {
+                size_t n = offsets[digit];
+                offsets[digit] = sum;
+                sum += n;
+            }
+
+            for ( size_t i = 0; i < count; i++ )
+                dst[offsets[radixDigit( src[i], pass )]++] = src[i];
+
+            std::swap( src, dst );
+        }
+
+        if ( src != data )
+            memcpy( data, src, count * sizeof( T ) );
+
+        delete[] ownScratch;
+    }
+
+    // Index of the first item not less than `value` (count if none)
+    template <typename T, typename K, class Compare = Less>
+    size_t lowerBound( const T* data, size_t count, const K& value, Compare less = Compare() )
+    {
+        if ( count == 0 )
+            return 0;
+
+        // Branch-free halving: the compiler turns the step into a conditional move
+        const T* base = data;
+
+        while ( count > 1 )
+        {
+            size_t half = count / 2;
+            base = less( base[half], value ) ? base + half : base;
+            count -= half;
+        }
+
+        return ( base - data ) + ( less( *base, value ) ? 1 : 0 );
+    }
+
+    // Index of the first item greater than `value` (count if none)
+    template <typename T, typename K, class Compare = Less>
+    size_t upperBound( const T* data, size_t count, const K& value, Compare less = Compare() )
+    {
+        if ( count == 0 )
+            return 0;
+
+        const T* base = data;
+
+        while ( count > 1 )
+        {
+            size_t half = count / 2;
+            base = !less( value, base[half] ) ? base + half : base;
+            count -= half;
+        }
+
+        return ( base - data ) + ( !less( value, *base ) ? 1 : 0 );
+    }
+
+    // Moves the items satisfying `pred` to the front and returns their number. Not stable.
+    template <typename T, class Predicate>
+    size_t partition( T* data, size_t count, Predicate pred )
+    {
+        size_t i = 0, j = count;
+
+        for ( ;; )
+        {
+            while ( i < j && pred( data[i] ) )
+                i++;
+
+            while ( i < j && !pred( data[j - 1] ) )
+                j--;
+
+            if ( i >= j )
+                return i;
+
+            std::swap( data[i++], data[--j] );
+        }
+    }
+
+    template <typename T, typename Acc, class Operation>
+    Acc reduce( const T* data, size_t count, Acc init, Operation op )
+    {
+        for ( size_t i = 0; i < count; i++ )
+            init = op( std::move( init ), data[i] );
+
+        return init;
+    }
+
+    // Container overloads
+
+    template <class Container, class Compare = Less>
+    auto sort( Container& items, Compare less = Compare() ) -> decltype( items.getLength(), void() )
+    {
+        sort( items.getPtrUnsafe(), items.getLength(), less );
+    }
+
+    template <class Container, class Compare = Less>
+    auto stableSort( Container& items, Compare less = Compare() ) -> decltype( items.getLength(), void() )
+    {
+        stableSort( items.getPtrUnsafe(), items.getLength(), less );
+    }
+
+    template <class Container>
+    auto radixSort( Container& items ) -> decltype( items.getLength(), void() )
+    {
+        radixSort( items.getPtrUnsafe(), items.getLength() );
+    }
+
+    template <class Container, typename K, class Compare = Less>
+    auto lowerBound( const Container& items, const K& value, Compare less = Compare() ) -> decltype( items.getLength() )
+    {
+        return lowerBound( items.getPtrUnsafe(), items.getLength(), value, less );
+    }
+
+    template <class Container, typename K, class Compare = Less>
+    auto upperBound( const Container& items, const K& value, Compare less = Compare() ) -> decltype( items.getLength() )
+    {
+        return upperBound( items.getPtrUnsafe(), items.getLength(), value, less );
+    }
+
+    template <class Container, class Predicate>
+    auto partition( Container& items, Predicate pred ) -> decltype( items.getLength() )
+    {
+        return partition( items.getPtrUnsafe(), items.getLength(), pred );
+    }
+
+    template <class Container, typename Acc, class Operation>
+    auto reduce( const Container& items, Acc init, Operation op ) -> decltype( items.getLength(), Acc() )
+    {
+        return reduce( items.getPtrUnsafe(), items.getLength(), std::move( init ), op );
+    }
 }
@@ -28,6 +28,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <type_traits>
 
 namespace li
 {
@@ -46,6 +47,14 @@ namespace li
         p->~Type();
     }
 
+    // Types which can be moved to a new address with memcpy/realloc, leaving nothing to destroy at the old one.
+    // Containers relocate all other types by move construction.
+    // Specialize for classes that never point into themselves (as littl's own strings and containers do).
+    template <typename T>
+    struct IsTriviallyRelocatable : std::is_trivially_copyable<T>
+    {
+    };
+
     template <typename T = uint8_t>
     class Allocator
     {
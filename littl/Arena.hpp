@@ -0,0 +1,487 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/Algorithm.hpp>
+#include <littl/Allocator.hpp>
+
+#include <algorithm>
+#include <cstddef>
+
+namespace li
+{
+    // Region allocator. Blocks are carved out of large chunks by bumping a pointer;
+    // all of them are released at once by reset() or by destroying the Arena.
+    //
+    // Containers reach the arena through ArenaAllocator, which allocates from the arena made current
+    // on this thread by an Arena::Scope (or from the heap if there is none).
+    // Every block remembers where it came from, so it can be resized and released outside of the scope, too.
+    // Neither an Arena nor a Pool is thread-safe; use one per thread.
+    class Arena
+    {
+        public:
+            class Scope
+            {
+                Arena* previous;
+
+                Scope( const Scope& );
+                Scope& operator = ( const Scope& );
+
+                public:
+                    Scope( Arena& arena ) : previous( getCurrent() ) { getCurrent() = &arena; }
+                    ~Scope() { getCurrent() = previous; }
+            };
+
+        private:
+            struct Chunk
+            {
+                Chunk* next;
+                size_t size;
+            };
+
+            struct BlockHeader
+            {
+                Arena* owner;
+                size_t numBytes;
+            };
+
+            enum
+            {
+                blockAlignment = alignof( std::max_align_t ),
+                chunkHeaderSize = ( sizeof( Chunk ) + blockAlignment - 1 ) & ~( blockAlignment - 1 ),
+                blockHeaderSize = ( sizeof( BlockHeader ) + blockAlignment - 1 ) & ~( blockAlignment - 1 )
+            };
+
+            Chunk* chunks;
+            uint8_t* top;
+            uint8_t* end;
+            size_t chunkSize;
+
+            Arena( const Arena& );
+            Arena& operator = ( const Arena& );
+
+            static BlockHeader* getHeader( void* pointer )
+            {
+                return reinterpret_cast<BlockHeader*>( reinterpret_cast<uint8_t*>( pointer ) - blockHeaderSize );
+            }
+
+            static size_t getBlockSize( size_t numBytes )
+            {
+                return align<blockAlignment>( blockHeaderSize + numBytes );
+            }
+
+            void addChunk( size_t minSize )
+            {
+                size_t size = std::max( chunkSize, chunkHeaderSize + minSize );
+
+                Chunk* chunk = reinterpret_cast<Chunk*>( malloc( size ) );
+
+                if ( chunk == nullptr )
+                    abort();
+
+                chunk->next = chunks;
+                chunk->size = size;
+                chunks = chunk;
+
+                top = reinterpret_cast<uint8_t*>( chunk ) + chunkHeaderSize;
+                end = reinterpret_cast<uint8_t*>( chunk ) + size;
+            }
+
+            bool isLastBlock( BlockHeader* header ) const
+            {
+                return reinterpret_cast<uint8_t*>( header ) + getBlockSize( header->numBytes ) == top;
+            }
+
+            void releaseBlock( BlockHeader* header )
+            {
+                // Only the most recent block can be given back
+                if ( isLastBlock( header ) )
+                    top = reinterpret_cast<uint8_t*>( header );
+            }
+
+            void* resizeBlock( BlockHeader* header, size_t numBytes )
+            {
+                if ( numBytes <= header->numBytes )
+                {
+                    if ( isLastBlock( header ) )
+                        top = reinterpret_cast<uint8_t*>( header ) + getBlockSize( numBytes );
+
+                    header->numBytes = numBytes;
+                    return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+                }
+
+                // Grow in place when this is the last block and the chunk has room
+                if ( isLastBlock( header ) && reinterpret_cast<uint8_t*>( header ) + getBlockSize( numBytes ) <= end )
+                {
+                    top = reinterpret_cast<uint8_t*>( header ) + getBlockSize( numBytes );
+                    header->numBytes = numBytes;
+                    return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+                }
+
+                uint8_t* oldData = reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+                void* newData = allocate( numBytes );
+                memcpy( newData, oldData, header->numBytes );
+                return newData;
+            }
+
+        public:
+            Arena( size_t chunkSize = 64 * 1024 ) : chunks( nullptr ), top( nullptr ), end( nullptr ), chunkSize( chunkSize )
+            {
+            }
+
+            ~Arena()
+            {
+                while ( chunks != nullptr )
+                {
+                    Chunk* next = chunks->next;
+                    free( chunks );
+                    chunks = next;
+                }
+            }
+
+            void* allocate( size_t numBytes )
+            {
+                const size_t blockSize = getBlockSize( numBytes );
+
+                if ( top == nullptr || blockSize > static_cast<size_t>( end - top ) )
+                    addChunk( blockSize );
+
+                BlockHeader* header = reinterpret_cast<BlockHeader*>( top );
+                header->owner = this;
+                header->numBytes = numBytes;
+
+                top += blockSize;
+                return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+            }
+
+            // Releases all blocks at once. The oldest chunk is kept for reuse.
+            // No container may still be using memory from this arena.
+            void reset()
+            {
+                if ( chunks == nullptr )
+                    return;
+
+                while ( chunks->next != nullptr )
+                {
+                    Chunk* next = chunks->next;
+                    free( chunks );
+                    chunks = next;
+                }
+
+                top = reinterpret_cast<uint8_t*>( chunks ) + chunkHeaderSize;
+                end = reinterpret_cast<uint8_t*>( chunks ) + chunks->size;
+            }
+
+            static Arena*& getCurrent()
+            {
+                static thread_local Arena* current = nullptr;
+                return current;
+            }
+
+            static void* allocateCurrent( size_t numBytes )
+            {
+                Arena* arena = getCurrent();
+
+                if ( arena != nullptr )
+                    return arena->allocate( numBytes );
+
+                BlockHeader* header = reinterpret_cast<BlockHeader*>( malloc( blockHeaderSize + numBytes ) );
+
+                if ( header == nullptr )
+                    abort();
+
+                header->owner = nullptr;
+                header->numBytes = numBytes;
+                return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+            }
+
+            static void release( void* pointer )
+            {
+                if ( pointer == nullptr )
+                    return;
+
+                BlockHeader* header = getHeader( pointer );
+
+                if ( header->owner != nullptr )
+                    header->owner->releaseBlock( header );
+                else
+                    free( header );
+            }
+
+            static void* resize( void* pointer, size_t numBytes )
+            {
+                if ( pointer == nullptr )
+                    return allocateCurrent( numBytes );
+
+                BlockHeader* header = getHeader( pointer );
+
+                if ( header->owner != nullptr )
+                    return header->owner->resizeBlock( header, numBytes );
+
+                header = reinterpret_cast<BlockHeader*>( realloc( header, blockHeaderSize + numBytes ) );
+
+                if ( header == nullptr )
+                    abort();
+
+                header->numBytes = numBytes;
+                return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+            }
+    };
+
+    // Fixed-size block allocator. Freed blocks go to a free list and are reused by the next allocation,
+    // which makes it a good fit for many small, similarly sized containers with independent lifetimes.
+    // Requests larger than the block size fall back to the heap.
+    class Pool
+    {
+        public:
+            class Scope
+            {
+                Pool* previous;
+
+                Scope( const Scope& );
+                Scope& operator = ( const Scope& );
+
+                public:
+                    Scope( Pool& pool ) : previous( getCurrent() ) { getCurrent() = &pool; }
+                    ~Scope() { getCurrent() = previous; }
+            };
+
+        private:
+            struct Chunk
+            {
+                Chunk* next;
+            };
+
+            struct BlockHeader
+            {
+                Pool* owner;
+                size_t numBytes;
+            };
+
+            struct FreeBlock
+            {
+                FreeBlock* next;
+            };
+
+            enum
+            {
+                blockAlignment = alignof( std::max_align_t ),
+                chunkHeaderSize = ( sizeof( Chunk ) + blockAlignment - 1 ) & ~( blockAlignment - 1 ),
+                blockHeaderSize = ( sizeof( BlockHeader ) + blockAlignment - 1 ) & ~( blockAlignment - 1 )
+            };
+
+            Chunk* chunks;
+            FreeBlock* freeList;
+            size_t blockSize, blocksPerChunk;
+
+            Pool( const Pool& );
+            Pool& operator = ( const Pool& );
+
+            static BlockHeader* getHeader( void* pointer )
+            {
+                return reinterpret_cast<BlockHeader*>( reinterpret_cast<uint8_t*>( pointer ) - blockHeaderSize );
+            }
+
+            static void* allocateFromHeap( size_t numBytes )
+            {
+                BlockHeader* header = reinterpret_cast<BlockHeader*>( malloc( blockHeaderSize + numBytes ) );
+
+                if ( header == nullptr )
+                    abort();
+
+                header->owner = nullptr;
+                header->numBytes = numBytes;
+                return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+            }
+
+            void addChunk()
+            {
+                const size_t stride = blockHeaderSize + blockSize;
+
+                Chunk* chunk = reinterpret_cast<Chunk*>( malloc( chunkHeaderSize + stride * blocksPerChunk ) );
+
+                if ( chunk == nullptr )
+                    abort();
+
+                chunk->next = chunks;
+                chunks = chunk;
+
+                uint8_t* blocks = reinterpret_cast<uint8_t*>( chunk ) + chunkHeaderSize;
+
+                for ( size_t i = blocksPerChunk; i > 0; i-- )
+                {
+                    FreeBlock* block = reinterpret_cast<FreeBlock*>( blocks + ( i - 1 ) * stride );
+                    block->next = freeList;
+                    freeList = block;
+                }
+            }
+
+            void releaseBlock( BlockHeader* header )
+            {
+                FreeBlock* block = reinterpret_cast<FreeBlock*>( header );
+                block->next = freeList;
+                freeList = block;
+            }
+
+        public:
+            Pool( size_t blockSize, size_t blocksPerChunk = 256 )
+                    : chunks( nullptr ), freeList( nullptr ), blockSize( align<blockAlignment>( blockSize ) ), blocksPerChunk( blocksPerChunk )
+            {
+            }
+
+            ~Pool()
+            {
+                while ( chunks != nullptr )
+                {
+                    Chunk* next = chunks->next;
+                    free( chunks );
+                    chunks = next;
+                }
+            }
+
+            void* allocate( size_t numBytes )
+            {
+                if ( numBytes > blockSize )
+                    return allocateFromHeap( numBytes );
+
+                if ( freeList == nullptr )
+                    addChunk();
+
+                BlockHeader* header = reinterpret_cast<BlockHeader*>( freeList );
+                freeList = freeList->next;
+
+                header->owner = this;
+                header->numBytes = numBytes;
+                return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+            }
+
+            size_t getBlockSize() const { return blockSize; }
+
+            static Pool*& getCurrent()
+            {
+                static thread_local Pool* current = nullptr;
+                return current;
+            }
+
+            static void* allocateCurrent( size_t numBytes )
+            {
+                Pool* pool = getCurrent();
+
+                if ( pool != nullptr )
+                    return pool->allocate( numBytes );
+                else
+                    return allocateFromHeap( numBytes );
+            }
+
+            static void release( void* pointer )
+            {
+                if ( pointer == nullptr )
+                    return;
+
+                BlockHeader* header = getHeader( pointer );
+
+                if ( header->owner != nullptr )
+                    header->owner->releaseBlock( header );
+                else
+                    free( header );
+            }
+
+            static void* resize( void* pointer, size_t numBytes )
+            {
+                if ( pointer == nullptr )
+                    return allocateCurrent( numBytes );
+
+                BlockHeader* header = getHeader( pointer );
+
+                if ( header->owner != nullptr && numBytes <= header->owner->blockSize )
+                {
+                    header->numBytes = numBytes;
+                    return pointer;
+                }
+
+                if ( header->owner == nullptr )
+                {
+                    header = reinterpret_cast<BlockHeader*>( realloc( header, blockHeaderSize + numBytes ) );
+
+                    if ( header == nullptr )
+                        abort();
+
+                    header->numBytes = numBytes;
+                    return reinterpret_cast<uint8_t*>( header ) + blockHeaderSize;
+                }
+
+                // Outgrew the pool block
+                void* newData = allocateFromHeap( numBytes );
+                memcpy( newData, pointer, header->numBytes );
+                release( pointer );
+                return newData;
+            }
+    };
+
+    template <typename T = uint8_t>
+    class ArenaAllocator : public Allocator<T>
+    {
+        public:
+            static T* allocate( size_t count )
+            {
+                T* pointer = reinterpret_cast<T*>( Arena::allocateCurrent( sizeof( T ) * count ) );
+                Allocator<T>::clear( pointer, count );
+                return pointer;
+            }
+
+            static T* release( void* pointer )
+            {
+                Arena::release( pointer );
+                return nullptr;
+            }
+
+            static T* resize( void* pointer, size_t count )
+            {
+                return reinterpret_cast<T*>( Arena::resize( pointer, sizeof( T ) * count ) );
+            }
+    };
+
+    template <typename T = uint8_t>
+    class PoolAllocator : public Allocator<T>
+    {
+        public:
+            static T* allocate( size_t count )
+            {
+                T* pointer = reinterpret_cast<T*>( Pool::allocateCurrent( sizeof( T ) * count ) );
+                Allocator<T>::clear( pointer, count );
+                return pointer;
+            }
+
+            static T* release( void* pointer )
+            {
+                Pool::release( pointer );
+                return nullptr;
+            }
+
+            static T* resize( void* pointer, size_t count )
+            {
+                return reinterpret_cast<T*>( Pool::resize( pointer, sizeof( T ) * count ) );
+            }
+    };
+}
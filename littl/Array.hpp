@@ -26,6 +26,8 @@
 #include <littl/Allocator.hpp>
 
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 
 #pragma warning ( push )
 
@@ -39,7 +41,11 @@ namespace li
     {
         enum
         {
-            noBoundsChecking = 1
+            noBoundsChecking = 1,
+
+            // Growth policy used by grow() (List::add, ArrayIOStream::write etc.); the default is 1.5x
+            exactGrowth = 2,
+            doublingGrowth = 4
         };
     }
 
@@ -53,6 +59,9 @@ namespace li
         T* data;
         TCapacity capacity;
 
+        void constructRange( TCapacity begin, TCapacity end );
+        void destructRange( TCapacity begin, TCapacity end );
+
         public:
             Array( TCapacity initialCapacity = 0 );
             Array( li_this&& other );
@@ -72,8 +81,10 @@ namespace li
             size_t getCapacity() const { return capacity; }
             T& getUnsafe( TCapacity field ) { return data[field]; }
             const T& getUnsafe( TCapacity field ) const { return data[field]; }
+            void grow( TCapacity minCapacity );
             void load( const T* source, TCapacity count, TCapacity offset = 0 );
             void move( TCapacity destField, TCapacity srcField, TCapacity length );
+            void reserve( TCapacity minCapacity ) { resize( minCapacity, true ); }
             void resize( TCapacity newCapacity, bool lazy = false );
             void set( TCapacity field, const T& value );
             void setUnsafe( TCapacity field, const T& value ) { data[field] = value; }
@@ -84,6 +95,11 @@ namespace li
             T* operator * () { return data; }
     };
 
+    template <typename T, typename TCapacity, class IAllocator, int options>
+    struct IsTriviallyRelocatable<li_this> : std::true_type
+    {
+    };
+
 #define li_member( type ) template<typename T, typename TCapacity, class IAllocator, int options> type li_this::
 #define li_member_ template<typename T, typename TCapacity, class IAllocator, int options> li_this::
 
@@ -91,10 +107,11 @@ namespace li
     {
         if ( initialCapacity > 0 )
         {
+            // allocate() zero-fills, which already is the value-initialized state of trivial types
             data = reinterpret_cast<T*>(IAllocator::allocate( capacity ));
 
-            for ( unsigned i = 0; i < capacity; i++ )
-                constructPointer( data + i );
+            if constexpr ( !std::is_trivially_default_constructible<T>::value )
+                constructRange( 0, capacity );
         }
         else
             data = nullptr;
@@ -113,8 +130,7 @@ namespace li
 
     li_member_ ~Array()
     {
-        for ( unsigned i = 0; i < capacity; i++ )
-            destructPointer( data + i );
+        destructRange( 0, capacity );
 
         IAllocator::release( data );
     }
@@ -127,7 +143,12 @@ namespace li
 
     li_member( li_this& ) operator = ( li_this&& other )
     {
-        resize( 0, false );
+        if ( this == &other )
+            return *this;
+
+        // resize( 0 ) would keep a minimal allocation around
+        destructRange( 0, capacity );
+        IAllocator::release( data );
 
         data = other.data;
         capacity = other.capacity;
@@ -137,6 +158,25 @@ namespace li
         return *this;
     }
 
+    li_member( void ) constructRange( TCapacity begin, TCapacity end )
+    {
+        if ( begin >= end )
+            return;
+
+        if constexpr ( std::is_trivially_default_constructible<T>::value )
+            IAllocator::clear( data + begin, end - begin );
+        else
+            for ( TCapacity i = begin; i < end; i++ )
+                constructPointer( data + i );
+    }
+
+    li_member( void ) destructRange( TCapacity begin, TCapacity end )
+    {
+        if constexpr ( !std::is_trivially_destructible<T>::value )
+            for ( TCapacity i = begin; i < end; i++ )
+                destructPointer( data + i );
+    }
+
     li_member( T* ) detachData()
     {
         T* ptr = data;
@@ -174,10 +214,33 @@ namespace li
         return data[field];
     }
 
+    li_member( void ) grow( TCapacity minCapacity )
+    {
+        if ( minCapacity <= capacity )
+            return;
+
+        // Amortized growth: appending n items one at a time only reallocates O(log n) times
+        TCapacity newCapacity;
+
+        if ( options & ArrayOptions::exactGrowth )
+            newCapacity = minCapacity;
+        else if ( options & ArrayOptions::doublingGrowth )
+            newCapacity = capacity * 2;
+        else
+            newCapacity = capacity + capacity / 2;
+
+        resize( std::max( newCapacity, minCapacity ), true );
+    }
+
     li_member( void ) load( const T* source, TCapacity count, TCapacity offset )
     {
         resize( offset + count );
-        IAllocator::move( data + offset, source, count );
+
+        if constexpr ( std::is_trivially_copyable<T>::value )
+            IAllocator::move( data + offset, source, count );
+        else
+            for ( TCapacity i = 0; i < count; i++ )
+                data[offset + i] = source[i];
     }
 
     li_member( void ) move( TCapacity destField, TCapacity srcField, TCapacity length )
@@ -189,24 +252,36 @@ namespace li
         if ( std::max( destField + length, srcField + length ) > capacity )
             resize( std::max( destField + length, srcField + length ) );
 
-        // Safely release all pointers in the destination area
-        if ( destField < srcField )
-            for ( TCapacity i = destField; i < destField + length && i < srcField; i++ )
-                destructPointer( data + i );
-        else
-            for ( TCapacity i = destField + length; i > destField && i > srcField + length; i-- )
-                destructPointer( data + i - 1 );
+        // The part of the source area not covered by the destination is left default-constructed
+        const TCapacity vacatedBegin = ( destField < srcField ) ? std::max( destField + length, srcField ) : srcField;
+        const TCapacity vacatedEnd = ( destField < srcField ) ? srcField + length : std::min( srcField + length, destField );
 
-        // Move the data
-        memmove( data + destField, data + srcField, length * sizeof( T ) );
+        if constexpr ( IsTriviallyRelocatable<T>::value )
+        {
+            // Safely release all pointers in the destination area
+            if ( destField < srcField )
+                destructRange( destField, std::min( destField + length, srcField ) );
+            else
+                destructRange( std::max( destField, srcField + length ), destField + length );
 
-        // Construct items in the source area (which aren't valid until this is done)
-        if ( destField < srcField )
-            for ( TCapacity i = srcField + length; i > srcField && i > destField + length; i-- )
-                constructPointer( data + i - 1 );
+            // Move the data
+            memmove( data + destField, data + srcField, length * sizeof( T ) );
+
+            // Construct items in the source area (which aren't valid until this is done)
+            constructRange( vacatedBegin, vacatedEnd );
+        }
         else
-            for ( TCapacity i = srcField; i < srcField + length && i < destField; i++ )
-                constructPointer( data + i );
+        {
+            if ( destField < srcField )
+                for ( TCapacity i = 0; i < length; i++ )
+                    data[destField + i] = std::move( data[srcField + i] );
+            else
+                for ( TCapacity i = length; i > 0; i-- )
+                    data[destField + i - 1] = std::move( data[srcField + i - 1] );
+
+            for ( TCapacity i = vacatedBegin; i < vacatedEnd; i++ )
+                data[i] = T();
+        }
     }
 
     li_member( void ) resize( TCapacity newCapacity, bool lazy )
@@ -218,18 +293,31 @@ namespace li
 
             // Release when shrinking (newCapacity < capacity)
             // If data == 0, then capacity == 0 so this is safe.
-            for ( TCapacity i = newCapacity; i < capacity; i++ )
-                destructPointer( data + i );
+            destructRange( newCapacity, capacity );
 
             TCapacity oldCapacity = capacity;
 
+            if constexpr ( IsTriviallyRelocatable<T>::value )
+                data = IAllocator::resize( data, newCapacity );
+            else
+            {
+                T* newData = IAllocator::resize( nullptr, newCapacity );
+
+                for ( TCapacity i = 0; i < oldCapacity && i < newCapacity; i++ )
+                {
+                    new ( static_cast<void*>( newData + i ) ) T( std::move( data[i] ) );
+                    destructPointer( data + i );
+                }
+
+                IAllocator::release( data );
+                data = newData;
+            }
+
             capacity = newCapacity;
-            data = IAllocator::resize( data, capacity );
 
             // Initialize when growing (oldSize < capacity)
             // Again, if data == 0, then capacity == 0 so this is safe.
-            for ( TCapacity i = oldCapacity; i < capacity; i++ )
-                constructPointer( data + i );
+            constructRange( oldCapacity, capacity );
         }
     }
 
@@ -0,0 +1,206 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/HashMap.hpp>
+#include <littl/Thread.hpp>
+
+namespace li
+{
+#define li_this ConcurrentHashMap<Key, Value, THasher, TKeyEqual, numShards, Size, IAllocator>
+
+    // Hash map shared between threads. Entries are spread over `numShards` independent HashMaps,
+    // each guarded by its own RWLock on its own cache line, so threads working on different keys rarely contend,
+    // and lookups of the same shard proceed in parallel.
+    // Values are handed out by copy (or through a callback that runs under the shard's lock), never by pointer.
+    template<typename Key, typename Value, class THasher = Hasher<Key>, class TKeyEqual = KeyEqual<Key>, int numShards = 64, typename Size = uint32_t,
+            template <typename> class IAllocator = Allocator>
+    class ConcurrentHashMap
+    {
+        static_assert( numShards > 0 && !( numShards & ( numShards - 1 ) ), "numShards must be power of 2" );
+
+        public:
+            typedef HashMap<Key, Value, THasher, TKeyEqual, Size, IAllocator> Map;
+            typedef typename Map::Hash Hash;
+
+        protected:
+            struct alignas( 64 ) Shard
+            {
+                RWLock lock;
+                Map map;
+            };
+
+            THasher hasher;
+            Shard shards[numShards];
+
+            // Hash the key the same way the shard's map would, so that the map doesn't have to hash it again
+            template <typename K> Hash getKeyHash( const K& key ) const { return hasher( Map::getLookupKey( key ) ); }
+
+            Shard& getShard( Hash hash )
+            {
+                // The maps use the low bits of the hash to pick a bucket, so re-mix it before picking a shard
+                return shards[hashInteger( static_cast<uint64_t>( hash ) ) & ( numShards - 1 )];
+            }
+
+            ConcurrentHashMap( const li_this& other );
+            li_this& operator =( const li_this& other );
+
+        public:
+            ConcurrentHashMap( const THasher& hasher = THasher() ) : hasher( hasher )
+            {
+                for ( Shard& shard : shards )
+                    shard.map = Map( 2, hasher );
+            }
+
+            void clear();
+            template <typename K> bool find( const K& key, Value& value_out );
+            template <typename K> Value get( const K& key );
+
+            // Calls `function( const Key& key, const Value& value )` for every entry, locking one shard at a time (shared).
+            // Entries added or removed concurrently in other shards may or may not be visited.
+            template <typename Function> void forEach( Function&& function );
+
+            size_t getNumEntries();
+
+            // Calls `function( Value& value )` under the shard's lock if the key exists
+            template <typename K, typename Function> bool modify( const K& key, Function&& function );
+
+            template <typename K, typename V> void set( K&& key, V&& value );
+
+            // Inserts the value if the key doesn't exist yet; returns false (and leaves the map unchanged) otherwise
+            template <typename K, typename V> bool setIfAbsent( K&& key, V&& value );
+
+            template <typename K> bool unset( const K& key );
+    };
+
+#define li_template template<typename Key, typename Value, class THasher, class TKeyEqual, int numShards, typename Size, template <typename> class IAllocator>
+
+    li_template void li_this::clear()
+    {
+        for ( Shard& shard : shards )
+        {
+            ScopedLock<RWLock> guard( shard.lock );
+            shard.map.clear();
+        }
+    }
+
+    li_template template <typename K> bool li_this::find( const K& key, Value& value_out )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        SharedScopedLock<RWLock> guard( shard.lock );
+
+        // Only const lookups are allowed under the shared lock
+        const Map& map = shard.map;
+        const Value* value = map.find( Map::getLookupKey( key ), hash );
+
+        if ( value == nullptr )
+            return false;
+
+        value_out = *value;
+        return true;
+    }
+
+    li_template template <typename Function> void li_this::forEach( Function&& function )
+    {
+        for ( Shard& shard : shards )
+        {
+            SharedScopedLock<RWLock> guard( shard.lock );
+
+            for ( auto iter = shard.map.getIterator(); iter.isValid(); ++iter )
+            {
+                const auto& pair = *iter;
+                function( pair.key, pair.value );
+            }
+        }
+    }
+
+    li_template template <typename K> Value li_this::get( const K& key )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        SharedScopedLock<RWLock> guard( shard.lock );
+
+        return shard.map.get( Map::getLookupKey( key ), hash );
+    }
+
+    li_template size_t li_this::getNumEntries()
+    {
+        size_t numEntries = 0;
+
+        for ( Shard& shard : shards )
+        {
+            SharedScopedLock<RWLock> guard( shard.lock );
+            numEntries += shard.map.getNumEntries();
+        }
+
+        return numEntries;
+    }
+
+    li_template template <typename K, typename Function> bool li_this::modify( const K& key, Function&& function )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        ScopedLock<RWLock> guard( shard.lock );
+
+        Value* value = shard.map.find( Map::getLookupKey( key ), hash );
+
+        if ( value == nullptr )
+            return false;
+
+        function( *value );
+        return true;
+    }
+
+    li_template template <typename K, typename V> void li_this::set( K&& key, V&& value )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        ScopedLock<RWLock> guard( shard.lock );
+
+        shard.map.insertOrAssign( std::forward<K>( key ), std::forward<V>( value ), hash );
+    }
+
+    li_template template <typename K, typename V> bool li_this::setIfAbsent( K&& key, V&& value )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        ScopedLock<RWLock> guard( shard.lock );
+
+        return shard.map.tryEmplaceWithHash( hash, std::forward<K>( key ), std::forward<V>( value ) ).second;
+    }
+
+    li_template template <typename K> bool li_this::unset( const K& key )
+    {
+        Hash hash = getKeyHash( key );
+        Shard& shard = getShard( hash );
+        ScopedLock<RWLock> guard( shard.lock );
+
+        return shard.map.unset( key, hash );
+    }
+
+#undef li_template
+
+#undef li_this
+}
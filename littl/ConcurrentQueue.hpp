@@ -0,0 +1,426 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/Base.hpp>
+#include <littl/Thread.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace li
+{
+    namespace ConcurrentQueueDetail
+    {
+        enum { cacheLineSize = 64 };
+
+        inline size_t roundUpToPowerOf2( size_t value )
+        {
+            size_t result = 2;
+
+            while ( result < value )
+                result *= 2;
+
+            return result;
+        }
+
+        // Lets consumers of a blocking queue sleep while it is empty. Every push then pays for a seq_cst fence
+        // (an mfence on x86) to pair with sleeping consumers, plus a lock and a notification if any are asleep.
+        template <bool blocking>
+        class Waiter
+        {
+            std::atomic<int> numSleepers;
+            FastMutex mutex;
+            ConditionVar cond;
+
+            public:
+                Waiter() : numSleepers( 0 ) {}
+
+                // Call after publishing an item
+                void notify()
+                {
+                    // Pairs with the fence in wait(): either we see the sleeper, or it sees our item
+                    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+                    if ( numSleepers.load( std::memory_order_relaxed ) > 0 )
+                    {
+                        ScopedLock<FastMutex> lock( mutex );
+                        cond.notifyAll();
+                    }
+                }
+
+                // Retries `tryPop` until it succeeds or `timeoutMs` (negative = forever) elapses
+                template <class TryPop>
+                bool wait( TryPop&& tryPop, int timeoutMs )
+                {
+                    enum { numSpins = 64 };
+
+                    for ( int i = 0; i < numSpins; i++ )
+                        if ( tryPop() )
+                            return true;
+
+                    if ( timeoutMs == 0 )
+                        return false;
+
+                    ScopedLock<FastMutex> lock( mutex );
+                    numSleepers.fetch_add( 1, std::memory_order_relaxed );
+                    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+                    bool success;
+
+                    if ( timeoutMs < 0 )
+                    {
+                        while ( !tryPop() )
+                            cond.wait( mutex );
+
+                        success = true;
+                    }
+                    else
+                        success = cond.waitFor( mutex, timeoutMs, tryPop );
+
+                    numSleepers.fetch_sub( 1, std::memory_order_relaxed );
+                    return success;
+                }
+        };
+
+        // Non-blocking queues have nobody to wake up, so pushes cost nothing extra
+        template <>
+        class Waiter<false>
+        {
+            public:
+                void notify() {}
+        };
+    }
+
+    // Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+    // Head and tail live on separate cache lines, and each side keeps a cached copy of the other's index
+    // so that it touches the shared line only when the queue looks full (or empty).
+    // Only a queue declared with `blocking` = true supports popWait(); its pushes then cost a full fence.
+    template <typename T, bool blocking = false>
+    class SpscQueue
+    {
+        typedef typename std::aligned_storage<sizeof( T ), alignof( T )>::type Slot;
+
+        alignas( ConcurrentQueueDetail::cacheLineSize ) std::atomic<size_t> tail;
+        size_t cachedHead;
+
+        alignas( ConcurrentQueueDetail::cacheLineSize ) std::atomic<size_t> head;
+        size_t cachedTail;
+
+        alignas( ConcurrentQueueDetail::cacheLineSize ) Slot* slots;
+        size_t mask;
+        ConcurrentQueueDetail::Waiter<blocking> waiter;
+
+        SpscQueue( const SpscQueue& );
+        SpscQueue& operator =( const SpscQueue& );
+
+        T* getSlot( size_t pos ) { return reinterpret_cast<T*>( &slots[pos & mask] ); }
+
+        public:
+            // The capacity is rounded up to a power of 2
+            SpscQueue( size_t capacity )
+                    : tail( 0 ), cachedHead( 0 ), head( 0 ), cachedTail( 0 )
+            {
+                capacity = ConcurrentQueueDetail::roundUpToPowerOf2( capacity );
+                slots = new Slot[capacity];
+                mask = capacity - 1;
+            }
+
+            ~SpscQueue()
+            {
+                for ( size_t pos = head.load(), end = tail.load(); pos != end; pos++ )
+                    getSlot( pos )->~T();
+
+                delete[] slots;
+            }
+
+            size_t getCapacity() const { return mask + 1; }
+
+            // Approximate when called while the other side is active
+            size_t getLength() const { return tail.load( std::memory_order_acquire ) - head.load( std::memory_order_acquire ); }
+
+            // Producer side
+
+            template <typename U>
+            bool push( U&& item )
+            {
+                size_t pos = tail.load( std::memory_order_relaxed );
+
+                if ( pos - cachedHead > mask )
+                {
+                    cachedHead = head.load( std::memory_order_acquire );
+
+                    if ( pos - cachedHead > mask )
+                        return false;
+                }
+
+                new ( getSlot( pos ) ) T( std::forward<U>( item ) );
+                tail.store( pos + 1, std::memory_order_release );
+                waiter.notify();
+                return true;
+            }
+
+            // Moves in as many of `items` as fit; returns their number
+            size_t push( T* items, size_t count )
+            {
+                size_t pos = tail.load( std::memory_order_relaxed );
+
+                if ( getCapacity() - ( pos - cachedHead ) < count )
+                    cachedHead = head.load( std::memory_order_acquire );
+
+                size_t space = getCapacity() - ( pos - cachedHead );
+
+                if ( count > space )
+                    count = space;
+
+                if ( count == 0 )
+                    return 0;
+
+                for ( size_t i = 0; i < count; i++ )
+                    new ( getSlot( pos + i ) ) T( std::move( items[i] ) );
+
+                tail.store( pos + count, std::memory_order_release );
+                waiter.notify();
+                return count;
+            }
+
+            // Consumer side
+
+            bool pop( T& item_out )
+            {
+                size_t pos = head.load( std::memory_order_relaxed );
+
+                if ( pos == cachedTail )
+                {
+                    cachedTail = tail.load( std::memory_order_acquire );
+
+                    if ( pos == cachedTail )
+                        return false;
+                }
+
+                T* item = getSlot( pos );
+                item_out = std::move( *item );
+                item->~T();
+
+                head.store( pos + 1, std::memory_order_release );
+                return true;
+            }
+
+            // Moves up to `maxCount` items out; returns their number
+            size_t pop( T* items_out, size_t maxCount )
+            {
+                size_t pos = head.load( std::memory_order_relaxed );
+
+                if ( cachedTail - pos < maxCount )
+                    cachedTail = tail.load( std::memory_order_acquire );
+
+                size_t count = cachedTail - pos;
+
+                if ( count > maxCount )
+                    count = maxCount;
+
+                for ( size_t i = 0; i < count; i++ )
+                {
+                    T* item = getSlot( pos + i );
+                    items_out[i] = std::move( *item );
+                    item->~T();
+                }
+
+                if ( count > 0 )
+                    head.store( pos + count, std::memory_order_release );
+
+                return count;
+            }
+
+            // Like pop(), but sleeps while the queue is empty. Returns false on timeout.
+            bool popWait( T& item_out, int timeoutMs = -1 )
+            {
+                static_assert( blocking, "popWait() needs a queue declared with blocking = true" );
+                return waiter.wait( [&] { return pop( item_out ); }, timeoutMs );
+            }
+    };
+
+    // Bounded lock-free queue for any number of producers and consumers (Dmitry Vyukov's design).
+    // Every cell carries a sequence number telling whether it is ready for the producer or the consumer
+    // of a given position, so each operation costs one CAS on the shared index in the uncontended case.
+    // Only a queue declared with `blocking` = true supports popWait(); its pushes then cost a full fence.
+    template <typename T, bool blocking = false>
+    class MpmcQueue
+    {
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            typename std::aligned_storage<sizeof( T ), alignof( T )>::type storage;
+
+            T* get() { return reinterpret_cast<T*>( &storage ); }
+        };
+
+        alignas( ConcurrentQueueDetail::cacheLineSize ) std::atomic<size_t> enqueuePos;
+        alignas( ConcurrentQueueDetail::cacheLineSize ) std::atomic<size_t> dequeuePos;
+        alignas( ConcurrentQueueDetail::cacheLineSize ) Cell* cells;
+        size_t mask;
+        ConcurrentQueueDetail::Waiter<blocking> waiter;
+
+        MpmcQueue( const MpmcQueue& );
+        MpmcQueue& operator =( const MpmcQueue& );
+
+        // Claims up to `maxCount` consecutive positions whose cells have sequence `pos + offset`
+        size_t claim( std::atomic<size_t>& index, size_t offset, size_t maxCount, size_t& pos_out )
+        {
+            size_t pos = index.load( std::memory_order_relaxed );
+
+            for ( ;; )
+            {
+                size_t count = 0;
+
+                while ( count < maxCount )
+                {
+                    size_t seq = cells[( pos + count ) & mask].sequence.load( std::memory_order_acquire );
+
+                    if ( seq != pos + count + offset )
+                        break;
+
+                    count++;
+                }
+
+                if ( count == 0 )
+                {
+                    size_t seq = cells[pos & mask].sequence.load( std::memory_order_acquire );
+
+                    // Cell still held by the previous lap: the queue is full (or empty)
+                    if ( static_cast<intptr_t>( seq - ( pos + offset ) ) < 0 )
+                        return 0;
+
+                    // Someone else claimed `pos` meanwhile
+                    pos = index.load( std::memory_order_relaxed );
+                    continue;
+                }
+
+                // Cells checked above can't change until their position is claimed, which this CAS prevents
+                if ( index.compare_exchange_weak( pos, pos + count, std::memory_order_relaxed ) )
+                {
+                    pos_out = pos;
+                    return count;
+                }
+            }
+        }
+
+        public:
+            // The capacity is rounded up to a power of 2
+            MpmcQueue( size_t capacity )
+                    : enqueuePos( 0 ), dequeuePos( 0 )
+            {
+                capacity = ConcurrentQueueDetail::roundUpToPowerOf2( capacity );
+                cells = new Cell[capacity];
+                mask = capacity - 1;
+
+                for ( size_t i = 0; i < capacity; i++ )
+                    cells[i].sequence.store( i, std::memory_order_relaxed );
+            }
+
+            ~MpmcQueue()
+            {
+                for ( size_t pos = dequeuePos.load(), end = enqueuePos.load(); pos != end; pos++ )
+                    cells[pos & mask].get()->~T();
+
+                delete[] cells;
+            }
+
+            size_t getCapacity() const { return mask + 1; }
+
+            // Approximate when called while other threads are active
+            size_t getLength() const
+            {
+                size_t dequeued = dequeuePos.load( std::memory_order_acquire );
+                size_t enqueued = enqueuePos.load( std::memory_order_acquire );
+                return ( enqueued > dequeued ) ? enqueued - dequeued : 0;
+            }
+
+            template <typename U>
+            bool push( U&& item )
+            {
+                size_t pos;
+
+                if ( !claim( enqueuePos, 0, 1, pos ) )
+                    return false;
+
+                Cell& cell = cells[pos & mask];
+                new ( cell.get() ) T( std::forward<U>( item ) );
+                cell.sequence.store( pos + 1, std::memory_order_release );
+
+                waiter.notify();
+                return true;
+            }
+
+            // Moves in as many of `items` as fit in one go; returns their number
+            size_t push( T* items, size_t count )
+            {
+                size_t pos;
+                count = claim( enqueuePos, 0, count, pos );
+
+                for ( size_t i = 0; i < count; i++ )
+                {
+                    Cell& cell = cells[( pos + i ) & mask];
+                    new ( cell.get() ) T( std::move( items[i] ) );
+                    cell.sequence.store( pos + i + 1, std::memory_order_release );
+                }
+
+                if ( count > 0 )
+                    waiter.notify();
+
+                return count;
+            }
+
+            bool pop( T& item_out )
+            {
+                return pop( &item_out, 1 ) == 1;
+            }
+
+            // Moves up to `maxCount` items out; returns their number
+            size_t pop( T* items_out, size_t maxCount )
+            {
+                size_t pos;
+                size_t count = claim( dequeuePos, 1, maxCount, pos );
+
+                for ( size_t i = 0; i < count; i++ )
+                {
+                    Cell& cell = cells[( pos + i ) & mask];
+                    items_out[i] = std::move( *cell.get() );
+                    cell.get()->~T();
+                    cell.sequence.store( pos + i + mask + 1, std::memory_order_release );
+                }
+
+                return count;
+            }
+
+            // Like pop(), but sleeps while the queue is empty. Returns false on timeout.
+            bool popWait( T& item_out, int timeoutMs = -1 )
+            {
+                static_assert( blocking, "popWait() needs a queue declared with blocking = true" );
+                return waiter.wait( [&] { return pop( item_out ); }, timeoutMs );
+            }
+    };
+}
@@ -155,10 +155,16 @@ namespace li
 
             virtual uint64_t getPos() override
             {
-                if ( handle )
-                    return ftell( handle );
-                else
+                if ( !handle )
                     return 0;
+
+#if defined( __li_MSW ) && !defined( __GNUC__ )
+                return _ftelli64( handle );
+#elif defined( __li_MSW )
+                return ftell( handle );
+#else
+                return ftello( handle );
+#endif
             }
 
             virtual uint64_t getSize() override
@@ -172,16 +178,29 @@ namespace li
                 _fseeki64( handle, 0, SEEK_END );
                 uint64_t size = _ftelli64( handle );
                 _fseeki64( handle, latestPos, SEEK_SET );
-#else
+
+                lastAccess = Access_none;
+                return size;
+#elif defined( __li_MSW )
                 size_t latestPos = ftell( handle );
                 fseek( handle, 0, SEEK_END );
                 size_t size = ftell( handle );
                 fseek( handle, latestPos, SEEK_SET );
-#endif
 
                 lastAccess = Access_none;
-
                 return size;
+#else
+                // Buffered writes have to reach the descriptor before it can report the size
+                if ( lastAccess == Access_write )
+                    fflush( handle );
+
+                struct stat st;
+
+                if ( fstat( fileno( handle ), &st ) != 0 )
+                    return 0;
+
+                return st.st_size;
+#endif
             }
 
             virtual bool setPos( uint64_t pos ) override
@@ -190,8 +209,10 @@ namespace li
                 {
 #if defined( __li_MSW ) && !defined( __GNUC__ )
                     _fseeki64( handle, pos, SEEK_SET );
-#else
+#elif defined( __li_MSW )
                     fseek( handle, pos, SEEK_SET );
+#else
+                    fseeko( handle, pos, SEEK_SET );
 #endif
                     return true;
                 }
@@ -0,0 +1,584 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <littl/Algorithm.hpp>
+#include <littl/Allocator.hpp>
+#include <littl/Hash.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <utility>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define li_FlatHashMap_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace li
+{
+    // Open-addressing hash map with inline storage.
+    // Every slot has a control byte which is either empty, deleted (tombstone) or holds the low 7 bits of the hash.
+    // Lookups scan 16 control bytes at once and only compare keys whose 7-bit fingerprint matches.
+    // The interface mirrors HashMap, so the two can be swapped with a typedef.
+    namespace FlatHashMapDetail
+    {
+        enum
+        {
+            groupWidth = 16,
+            minShiftAmount = 4
+        };
+
+        enum : int8_t
+        {
+            ctrlEmpty = -128,
+            ctrlDeleted = -2
+        };
+
+        inline unsigned countTrailingZeros( uint32_t mask )
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward( &index, mask );
+            return index;
+#else
+            return __builtin_ctz( mask );
+#endif
+        }
+
+        inline unsigned countLeadingZeros16( uint32_t mask )
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse( &index, mask );
+            return 15 - index;
+#else
+            return __builtin_clz( mask ) - 16;
+#endif
+        }
+
+        // A bit mask with one bit per control byte of a group
+        class Group
+        {
+            const int8_t* ctrl;
+
+            public:
+                Group( const int8_t* ctrl ) : ctrl( ctrl ) {}
+
+#ifdef li_FlatHashMap_SSE2
+                uint32_t match( int8_t value ) const
+                {
+                    const __m128i group = _mm_loadu_si128( reinterpret_cast<const __m128i*>( ctrl ) );
+                    return _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_set1_epi8( value ), group ) );
+                }
+
+                uint32_t matchEmptyOrDeleted() const
+                {
+                    // Empty and deleted are the only control values with the sign bit set
+                    const __m128i group = _mm_loadu_si128( reinterpret_cast<const __m128i*>( ctrl ) );
+                    return _mm_movemask_epi8( group );
+                }
+#else
+                uint32_t match( int8_t value ) const
+                {
+                    uint32_t mask = 0;
+
+                    for ( unsigned i = 0; i < groupWidth; i++ )
+                        if ( ctrl[i] == value )
+                            mask |= ( 1 << i );
+
+                    return mask;
+                }
+
+                uint32_t matchEmptyOrDeleted() const
+                {
+                    uint32_t mask = 0;
+
+                    for ( unsigned i = 0; i < groupWidth; i++ )
+                        if ( ctrl[i] < 0 )
+                            mask |= ( 1 << i );
+
+                    return mask;
+                }
+#endif
+
+                uint32_t matchEmpty() const { return match( ctrlEmpty ); }
+        };
+
+        // Spreads weak hashes (such as identity hashes of integers) over all bits
+        inline size_t mix( size_t hash )
+        {
+#if SIZE_MAX > 0xFFFFFFFF
+            uint64_t h = static_cast<uint64_t>( hash ) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<size_t>( h ^ ( h >> 32 ) );
+#else
+            uint32_t h = static_cast<uint32_t>( hash ) * 0x9E3779B9U;
+            return h ^ ( h >> 16 );
+#endif
+        }
+    }
+
+#define li_this FlatHashMap<Key, Value, THasher, TKeyEqual, Size, IAllocator>
+
+    template<typename Key, typename Value, class THasher = Hasher<Key>, class TKeyEqual = KeyEqual<Key>, typename Size = uint32_t,
+            template <typename> class IAllocator = Allocator>
+    class FlatHashMap
+    {
+        protected:
+            struct Pair;
+
+            class Iterator
+            {
+                li_this& hashMap;
+                Size slot;
+
+                void adjust()
+                {
+                    while ( slot < hashMap.numSlots && hashMap.ctrl[slot] < 0 )
+                        slot++;
+                }
+
+                Iterator operator = ( const Iterator& );
+
+                public:
+                    Iterator( li_this& hashMap ) : hashMap( hashMap ), slot( 0 )
+                    {
+                        adjust();
+                    }
+
+                    operator Pair&() { return hashMap.slots[slot]; }
+                    Value& operator -> () { return hashMap.slots[slot].value; }
+                    Pair& operator * () { return hashMap.slots[slot]; }
+                    void operator ++() { slot++; adjust(); }
+
+                    bool isValid() const { return slot < hashMap.numSlots; }
+            };
+
+            struct Pair
+            {
+                Key key;
+                Value value;
+            };
+
+            // numSlots + groupWidth control bytes; the last group mirrors the first one so that any probe position can be loaded unaligned
+            int8_t* ctrl;
+            Pair* slots;
+            Size numSlots, numEntries, numDeleted, shiftAmount;
+
+            THasher hasher;
+            TKeyEqual keyEqual;
+
+            size_t getSlotHash( const Key& key ) const { return FlatHashMapDetail::mix( static_cast<size_t>( hasher( key ) ) ); }
+            static int8_t getH2( size_t hash ) { return static_cast<int8_t>( hash & 0x7F ); }
+            static size_t getH1( size_t hash ) { return hash >> 7; }
+
+            Size findSlot( const Key& key, size_t hash ) const;
+            Size findFirstNonFull( size_t hash ) const;
+            bool getOrSetWithoutInitialization( Key&& key, Pair*& pair_out );
+            Size getMaxLoad() const { return numSlots - numSlots / 8; }
+            void setCtrl( Size slot, int8_t value );
+
+            static void releaseSlots( int8_t* ctrl, Pair* slots, Size numSlots );
+
+            FlatHashMap( const li_this& other );
+            li_this& operator =( const li_this& other );
+
+        public:
+            FlatHashMap( Size shiftAmount = 0, const THasher& hasher = THasher(), const TKeyEqual& keyEqual = TKeyEqual() );
+            FlatHashMap( li_this&& other );
+            ~FlatHashMap();
+            li_this& operator =( li_this&& other );
+
+            void clear();
+            Value* find( const Key& key );
+            Value get( const Key& key ) const;
+            Iterator getIterator() { return Iterator( *this ); }
+            Size getNumEntries() const { return numEntries; }
+            void printStatistics();
+            void reserve( Size count );
+            void resize( Size shiftAmount, bool lazy = false );
+            Value& setEmpty( Key&& key );
+            Value& set( Key&& key, Value&& value );
+            bool unset( const Key& key );
+    };
+
+#define li_member( type ) template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator> type li_this::
+#define li_member_ template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator> li_this::
+
+    li_member_ FlatHashMap( Size shiftAmount, const THasher& hasher, const TKeyEqual& keyEqual )
+            : ctrl( nullptr ), slots( nullptr ), numSlots( 0 ), numEntries( 0 ), numDeleted( 0 ), shiftAmount( 0 ),
+            hasher( hasher ), keyEqual( keyEqual )
+    {
+        if ( shiftAmount > 0 )
+            resize( shiftAmount );
+    }
+
+    li_member_ FlatHashMap( li_this&& other )
+            : ctrl( other.ctrl ), slots( other.slots ), numSlots( other.numSlots ), numEntries( other.numEntries ),
+            numDeleted( other.numDeleted ), shiftAmount( other.shiftAmount ),
+            hasher( std::move( other.hasher ) ), keyEqual( std::move( other.keyEqual ) )
+    {
+        other.ctrl = nullptr;
+        other.slots = nullptr;
+        other.numSlots = 0;
+        other.numEntries = 0;
+        other.numDeleted = 0;
+        other.shiftAmount = 0;
+    }
+
+    li_member_ ~FlatHashMap()
+    {
+        clear();
+    }
+
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    li_this& li_this::operator =( li_this&& other )
+    {
+        clear();
+
+        ctrl = other.ctrl;
+        slots = other.slots;
+        numSlots = other.numSlots;
+        numEntries = other.numEntries;
+        numDeleted = other.numDeleted;
+        shiftAmount = other.shiftAmount;
+        hasher = std::move( other.hasher );
+        keyEqual = std::move( other.keyEqual );
+
+        other.ctrl = nullptr;
+        other.slots = nullptr;
+        other.numSlots = 0;
+        other.numEntries = 0;
+        other.numDeleted = 0;
+        other.shiftAmount = 0;
+
+        return *this;
+    }
+
+    li_member( void ) clear()
+    {
+        releaseSlots( ctrl, slots, numSlots );
+
+        ctrl = nullptr;
+        slots = nullptr;
+        numSlots = 0;
+        numEntries = 0;
+        numDeleted = 0;
+        shiftAmount = 0;
+    }
+
+    li_member( Value* ) find( const Key& key )
+    {
+        if ( numEntries == 0 )
+            return nullptr;
+
+        Size slot = findSlot( key, getSlotHash( key ) );
+
+        if ( slot < numSlots )
+            return &slots[slot].value;
+        else
+            return nullptr;
+    }
+
+    li_member( Size ) findFirstNonFull( size_t hash ) const
+    {
+        const Size mask = numSlots - 1;
+        Size pos = static_cast<Size>( getH1( hash ) ) & mask;
+
+        for ( Size step = FlatHashMapDetail::groupWidth; ; step += FlatHashMapDetail::groupWidth )
+        {
+            uint32_t free = FlatHashMapDetail::Group( ctrl + pos ).matchEmptyOrDeleted();
+
+            if ( free )
+                return ( pos + FlatHashMapDetail::countTrailingZeros( free ) ) & mask;
+
+            pos = ( pos + step ) & mask;
+        }
+    }
+
+    li_member( Size ) findSlot( const Key& key, size_t hash ) const
+    {
+        const Size mask = numSlots - 1;
+        const int8_t h2 = getH2( hash );
+        Size pos = static_cast<Size>( getH1( hash ) ) & mask;
+
+        // Triangular probing over groups visits every group exactly once when numSlots is a power of 2
+        for ( Size step = FlatHashMapDetail::groupWidth; step <= numSlots; step += FlatHashMapDetail::groupWidth )
+        {
+            const FlatHashMapDetail::Group group( ctrl + pos );
+
+            for ( uint32_t matches = group.match( h2 ); matches; matches &= matches - 1 )
+            {
+                Size slot = ( pos + FlatHashMapDetail::countTrailingZeros( matches ) ) & mask;
+
+                if ( keyEqual( slots[slot].key, key ) )
+                    return slot;
+            }
+
+            if ( group.matchEmpty() )
+                break;
+
+            pos = ( pos + step ) & mask;
+        }
+
+        return numSlots;
+    }
+
+    li_member( Value ) get( const Key& key ) const
+    {
+        if ( numEntries == 0 )
+            return 0;
+
+        Size slot = findSlot( key, getSlotHash( key ) );
+
+        if ( slot < numSlots )
+            return slots[slot].value;
+        else
+            return 0;
+    }
+
+    li_member( bool ) getOrSetWithoutInitialization( Key&& key, Pair*& pair_out )
+    {
+        size_t hash = getSlotHash( key );
+
+        if ( numEntries > 0 )
+        {
+            Size slot = findSlot( key, hash );
+
+            if ( slot < numSlots )
+            {
+                pair_out = &slots[slot];
+                return false;
+            }
+        }
+
+        if ( numSlots == 0 )
+            resize( FlatHashMapDetail::minShiftAmount );
+
+        Size slot = findFirstNonFull( hash );
+
+        if ( ctrl[slot] == FlatHashMapDetail::ctrlEmpty && numEntries + numDeleted + 1 > getMaxLoad() )
+        {
+            // Out of empty slots. If the table is mostly tombstones, rehashing in place is enough.
+            if ( numEntries + 1 <= getMaxLoad() / 2 )
+                resize( shiftAmount, false );
+            else
+                resize( shiftAmount + 1, false );
+
+            slot = findFirstNonFull( hash );
+        }
+
+        if ( ctrl[slot] == FlatHashMapDetail::ctrlDeleted )
+            numDeleted--;
+
+        setCtrl( slot, getH2( hash ) );
+        numEntries++;
+
+        constructPointer( &slots[slot].key, std::forward<Key>( key ) );
+
+        pair_out = &slots[slot];
+        return true;
+    }
+
+    li_member( void ) printStatistics()
+    {
+        printf( "FlatHashMap: %" PRIuPTR " slots (shift = %" PRIuPTR "); %" PRIuPTR " entries, %" PRIuPTR " tombstones\n",
+                ( size_t ) numSlots, ( size_t ) shiftAmount, ( size_t ) numEntries, ( size_t ) numDeleted );
+
+        size_t totalDistance = 0, maxDistance = 0;
+
+        for ( Size i = 0; i < numSlots; i++ )
+        {
+            if ( ctrl[i] < 0 )
+                continue;
+
+            size_t home = getH1( getSlotHash( slots[i].key ) ) & ( numSlots - 1 );
+            size_t distance = ( i - home ) & ( numSlots - 1 );
+
+            totalDistance += distance;
+            maxDistance = std::max( maxDistance, distance );
+        }
+
+        if ( numEntries > 0 )
+            printf( "  - average probe distance %.2f, maximum %" PRIuPTR "\n", ( double ) totalDistance / numEntries, maxDistance );
+    }
+
+    li_member( void ) releaseSlots( int8_t* ctrl, Pair* slots, Size numSlots )
+    {
+        for ( Size i = 0; i < numSlots; i++ )
+        {
+            if ( ctrl[i] >= 0 )
+            {
+                destructPointer( &slots[i].key );
+                destructPointer( &slots[i].value );
+            }
+        }
+
+        // Control bytes and slots share a single block
+        IAllocator<uint8_t>::release( ctrl );
+    }
+
+    li_member( void ) reserve( Size count )
+    {
+        Size shiftAmount = FlatHashMapDetail::minShiftAmount;
+
+        while ( ( Size( 1 ) << shiftAmount ) - ( Size( 1 ) << shiftAmount ) / 8 < count )
+            shiftAmount++;
+
+        resize( shiftAmount, true );
+    }
+
+    li_member( void ) resize( Size shiftAmount, bool lazy )
+    {
+        if ( shiftAmount < FlatHashMapDetail::minShiftAmount )
+            shiftAmount = FlatHashMapDetail::minShiftAmount;
+
+        // Never shrink below what is needed to hold the current entries
+        while ( ( Size( 1 ) << shiftAmount ) - ( Size( 1 ) << shiftAmount ) / 8 < numEntries )
+            shiftAmount++;
+
+        Size numSlots = ( Size( 1 ) << shiftAmount );
+
+        if ( lazy && numSlots <= this->numSlots )
+            return;
+
+        // Rehashing to the same size is still useful to purge tombstones
+        if ( numSlots == this->numSlots && numDeleted == 0 )
+            return;
+
+        const size_t numCtrlBytes = numSlots + FlatHashMapDetail::groupWidth;
+        const size_t slotsOffset = align<alignof( Pair )>( numCtrlBytes );
+
+        uint8_t* block = IAllocator<uint8_t>::resize( nullptr, slotsOffset + numSlots * sizeof( Pair ) );
+
+        int8_t* ctrl = reinterpret_cast<int8_t*>( block );
+        Pair* slots = reinterpret_cast<Pair*>( block + slotsOffset );
+
+        memset( ctrl, FlatHashMapDetail::ctrlEmpty, numCtrlBytes );
+
+        int8_t* oldCtrl = this->ctrl;
+        Pair* oldSlots = this->slots;
+        Size oldNumSlots = this->numSlots;
+
+        this->ctrl = ctrl;
+        this->slots = slots;
+        this->numSlots = numSlots;
+        this->shiftAmount = shiftAmount;
+        this->numDeleted = 0;
+
+        // Re-insert the original entries; the new table has no tombstones and no duplicates, so no key comparisons are needed
+        for ( Size i = 0; i < oldNumSlots; i++ )
+        {
+            if ( oldCtrl[i] < 0 )
+                continue;
+
+            size_t hash = getSlotHash( oldSlots[i].key );
+            Size slot = findFirstNonFull( hash );
+
+            setCtrl( slot, getH2( hash ) );
+
+            constructPointer( &slots[slot].key,   std::move( oldSlots[i].key ) );
+            constructPointer( &slots[slot].value, std::move( oldSlots[i].value ) );
+        }
+
+        if ( oldCtrl != nullptr )
+            releaseSlots( oldCtrl, oldSlots, oldNumSlots );
+    }
+
+    li_member( void ) setCtrl( Size slot, int8_t value )
+    {
+        ctrl[slot] = value;
+
+        if ( slot < FlatHashMapDetail::groupWidth )
+            ctrl[numSlots + slot] = value;
+    }
+
+    li_member( Value& ) set( Key&& key, Value&& value )
+    {
+        Pair* pair;
+
+        if ( !getOrSetWithoutInitialization( std::forward<Key>( key ), pair ) )
+        {
+            pair->value = std::move( value );
+            return pair->value;
+        }
+
+        constructPointer( &pair->value, std::move( value ) );
+        return pair->value;
+    }
+
+    li_member( Value& ) setEmpty( Key&& key )
+    {
+        Pair* pair;
+
+        if ( !getOrSetWithoutInitialization( std::forward<Key>( key ), pair ) )
+            return pair->value;
+
+        constructPointer( &pair->value );
+        return pair->value;
+    }
+
+    li_member( bool ) unset( const Key& key )
+    {
+        if ( numEntries == 0 )
+            return false;
+
+        Size slot = findSlot( key, getSlotHash( key ) );
+
+        if ( slot >= numSlots )
+            return false;
+
+        destructPointer( &slots[slot].key );
+        destructPointer( &slots[slot].value );
+
+        // If every group window covering this slot also contains an empty byte, no probe sequence ever continued past it,
+        // so it can be marked empty instead of leaving a tombstone
+        const Size mask = numSlots - 1;
+        const uint32_t emptyBefore = FlatHashMapDetail::Group( ctrl + ( ( slot - FlatHashMapDetail::groupWidth ) & mask ) ).matchEmpty();
+        const uint32_t emptyAfter = FlatHashMapDetail::Group( ctrl + slot ).matchEmpty();
+
+        const bool wasNeverFull = emptyBefore && emptyAfter &&
+                FlatHashMapDetail::countTrailingZeros( emptyAfter ) + FlatHashMapDetail::countLeadingZeros16( emptyBefore ) < FlatHashMapDetail::groupWidth;
+
+        if ( wasNeverFull )
+            setCtrl( slot, FlatHashMapDetail::ctrlEmpty );
+        else
+        {
+            setCtrl( slot, FlatHashMapDetail::ctrlDeleted );
+            numDeleted++;
+        }
+
+        numEntries--;
+        return true;
+    }
+
+#undef li_member
+#undef li_member_
+
+#undef li_this
+}
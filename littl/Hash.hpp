@@ -0,0 +1,212 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/Base.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined( _MSC_VER ) && defined( _M_X64 )
+#include <intrin.h>
+#endif
+
+namespace li
+{
+    namespace HashDetail
+    {
+        inline void multiply128( uint64_t& a, uint64_t& b )
+        {
+#if defined( __SIZEOF_INT128__ )
+            __uint128_t r = static_cast<__uint128_t>( a ) * b;
+            a = static_cast<uint64_t>( r );
+            b = static_cast<uint64_t>( r >> 64 );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+            a = _umul128( a, b, &b );
+#else
+            uint64_t ha = a >> 32, hb = b >> 32, la = ( uint32_t ) a, lb = ( uint32_t ) b;
+            uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + ( rm0 << 32 ), c = t < rl;
+            uint64_t lo = t + ( rm1 << 32 );
+            c += lo < t;
+            uint64_t hi = rh + ( rm0 >> 32 ) + ( rm1 >> 32 ) + c;
+            a = lo;
+            b = hi;
+#endif
+        }
+
+        inline uint64_t mix( uint64_t a, uint64_t b )
+        {
+            multiply128( a, b );
+            return a ^ b;
+        }
+
+        inline uint64_t read64( const uint8_t* p ) { uint64_t v; memcpy( &v, p, 8 ); return v; }
+        inline uint64_t read32( const uint8_t* p ) { uint32_t v; memcpy( &v, p, 4 ); return v; }
+
+        inline uint64_t read3( const uint8_t* p, size_t k )
+        {
+            return ( static_cast<uint64_t>( p[0] ) << 16 ) | ( static_cast<uint64_t>( p[k >> 1] ) << 8 ) | p[k - 1];
+        }
+
+        static const uint64_t secret[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+    }
+
+    // Fast, length-aware hash of a byte range (wyhash), reading 8 or 16 bytes per step.
+    // Not cryptographic, but with a secret seed it resists deliberate collisions far better than the classic rotate-xor.
+    inline uint64_t hashBytes( const void* data, size_t numBytes, uint64_t seed = 0 )
+    {
+        using namespace HashDetail;
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>( data );
+        uint64_t a, b;
+
+        seed ^= mix( seed ^ secret[0], secret[1] );
+
+        if ( numBytes <= 16 )
+        {
+            if ( numBytes >= 4 )
+            {
+                a = ( read32( p ) << 32 ) | read32( p + ( ( numBytes >> 3 ) << 2 ) );
+                b = ( read32( p + numBytes - 4 ) << 32 ) | read32( p + numBytes - 4 - ( ( numBytes >> 3 ) << 2 ) );
+            }
+            else if ( numBytes > 0 )
+            {
+                a = read3( p, numBytes );
+                b = 0;
+            }
+            else
+                a = b = 0;
+        }
+        else
+        {
+            size_t i = numBytes;
+
+            if ( i > 48 )
+            {
+                uint64_t see1 = seed, see2 = seed;
+
+                do
+                {
+                    seed = mix( read64( p ) ^ secret[1], read64( p + 8 ) ^ seed );
+                    see1 = mix( read64( p + 16 ) ^ secret[2], read64( p + 24 ) ^ see1 );
+                    see2 = mix( read64( p + 32 ) ^ secret[3], read64( p + 40 ) ^ see2 );
+                    p += 48;
+                    i -= 48;
+                }
+                while ( i > 48 );
+
+                seed ^= see1 ^ see2;
+            }
+
+            while ( i > 16 )
+            {
+                seed = mix( read64( p ) ^ secret[1], read64( p + 8 ) ^ seed );
+                i -= 16;
+                p += 16;
+            }
+
+            a = read64( p + i - 16 );
+            b = read64( p + i - 8 );
+        }
+
+        a ^= secret[1];
+        b ^= seed;
+        multiply128( a, b );
+        return mix( a ^ secret[0] ^ numBytes, b ^ secret[1] );
+    }
+
+    inline uint64_t hashInteger( uint64_t value, uint64_t seed = 0 )
+    {
+        return HashDetail::mix( value ^ seed ^ HashDetail::secret[0], HashDetail::secret[1] ^ seed );
+    }
+
+    // Random per-process seed for the default hashers, so that keys fed from the network can't be chosen to collide.
+    // Derived from ASLR and the clock; not suitable for anything cryptographic.
+    inline uint64_t getProcessHashSeed()
+    {
+        static const uint64_t seed = hashInteger(
+                static_cast<uint64_t>( reinterpret_cast<uintptr_t>( &seed ) ),
+                static_cast<uint64_t>( std::chrono::high_resolution_clock::now().time_since_epoch().count() ) );
+
+        return seed;
+    }
+
+    // Default hasher used by HashMap and FlatHashMap. Hashers are function objects so they can carry state
+    // (such as a seed) and be inlined. Hashers that define `is_transparent` accept foreign key types,
+    // which lets the maps look keys up without converting them first.
+    //
+    // For class types, the primary template falls back to the static T::getHash (and its overloads).
+    template <typename T, typename Enable = void>
+    struct Hasher
+    {
+        typedef void is_transparent;
+
+        template <typename K>
+        auto operator()( const K& key ) const -> decltype( T::getHash( key ) )
+        {
+            return T::getHash( key );
+        }
+    };
+
+    template <typename T>
+    struct Hasher<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+    {
+        uint64_t seed;
+
+        Hasher() : seed( getProcessHashSeed() ) {}
+        Hasher( uint64_t seed ) : seed( seed ) {}
+
+        size_t operator()( T key ) const { return static_cast<size_t>( hashInteger( static_cast<uint64_t>( key ), seed ) ); }
+    };
+
+    template <typename T>
+    struct Hasher<T*, void>
+    {
+        uint64_t seed;
+
+        Hasher() : seed( getProcessHashSeed() ) {}
+        Hasher( uint64_t seed ) : seed( seed ) {}
+
+        size_t operator()( const T* key ) const { return static_cast<size_t>( hashInteger( reinterpret_cast<uintptr_t>( key ), seed ) ); }
+    };
+
+    template <typename T>
+    struct KeyEqual
+    {
+        typedef void is_transparent;
+
+        template <typename K>
+        bool operator()( const T& a, const K& b ) const { return a == b; }
+    };
+
+    // Adapts a plain hash function, as taken by HashMap originally
+    template <typename Key, typename Hash, Hash ( *getHash )( const Key& )>
+    struct HashFunction
+    {
+        Hash operator()( const Key& key ) const { return getHash( key ); }
+    };
+}
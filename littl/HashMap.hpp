@@ -23,28 +23,45 @@
 #pragma once
 
 #include <littl/Allocator.hpp>
+#include <littl/Hash.hpp>
 
 #include <cinttypes>
+#include <cstdio>
 #include <utility>
-
 namespace li
 {
-#define li_this HashMap<Key, Value, Hash, getHash, Size>
+#define li_this HashMap<Key, Value, THasher, TKeyEqual, Size, IAllocator>
 
-    template<typename Key, typename Value, typename Hash = size_t, Hash ( *getHash )( const Key& ) = Key::getHash, typename Size = uint32_t>
+    template<typename Key, typename Value, class THasher = Hasher<Key>, class TKeyEqual = KeyEqual<Key>, typename Size = uint32_t,
+            template <typename> class IAllocator = Allocator>
     class HashMap
     {
+        public:
+            typedef decltype( std::declval<const THasher&>()( std::declval<const Key&>() ) ) Hash;
+
         protected:
+            struct Bucket;
             struct Pair;
 
             class Iterator
             {
-                HashMap<Key, Value, Hash, getHash, Size>& hashMap;
+                li_this& hashMap;
                 Size bucket, i;
 
+                // Buckets of the table being migrated (if any) follow after the current ones
+                Bucket& getBucket() const
+                {
+                    if ( bucket < hashMap.numBuckets )
+                        return hashMap.buckets[bucket];
+                    else
+                        return hashMap.oldBuckets[bucket - hashMap.numBuckets];
+                }
+
+                Size getNumBuckets() const { return hashMap.numBuckets + hashMap.oldNumBuckets; }
+
                 void adjust()
                 {
-                    while ( bucket < hashMap.numBuckets && i >= hashMap.buckets[bucket].numEntries )
+                    while ( bucket < getNumBuckets() && i >= getBucket().numEntries )
                     {
                         i = 0;
                         bucket++;
@@ -54,17 +71,17 @@ namespace li
                 Iterator operator = ( const Iterator& );
 
                 public:
-                    Iterator( HashMap<Key, Value, Hash, getHash, Size>& hashMap ) : hashMap( hashMap ), bucket( 0 ), i( 0 )
+                    Iterator( li_this& hashMap ) : hashMap( hashMap ), bucket( 0 ), i( 0 )
                     {
                         adjust();
                     }
 
-                    operator Pair&() { return hashMap.buckets[bucket].entries[i]; }
-                    Value& operator -> () { return hashMap.buckets[bucket].entries[i].value; }
-                    Pair& operator * () { return hashMap.buckets[bucket].entries[i]; }
+                    operator Pair&() { return getBucket().entries[i]; }
+                    Value& operator -> () { return getBucket().entries[i].value; }
+                    Pair& operator * () { return getBucket().entries[i]; }
                     void operator ++() { i++; adjust(); }
 
-                    bool isValid() const { return bucket < hashMap.numBuckets && i < hashMap.buckets[bucket].numEntries; }
+                    bool isValid() const { return bucket < getNumBuckets() && i < getBucket().numEntries; }
             };
 
             struct Pair
@@ -83,47 +100,111 @@ namespace li
             Bucket* buckets;
             Size numBuckets, numEntries, shiftAmount;
 
-            Pair* findPair( const Key& key );
-            bool getOrSetWithoutInitialization( Key&& key, Pair*& pair_out );
+            // Incremental resizing: while oldBuckets is set, entries are still being moved out of it,
+            // `bucketsPerStep` buckets at a time. Buckets below migrateIndex have already been emptied.
+            Bucket* oldBuckets;
+            Size oldNumBuckets, migrateIndex, bucketsPerStep;
+
+            THasher hasher;
+            TKeyEqual keyEqual;
+
+            static Bucket* allocateBuckets( Size numBuckets );
+            static Pair& appendToBucket( Bucket& bucket );
+            void finishMigration();
+            template <typename K> Pair* findPair( const K& key, Hash hash );
+            template <typename K> Pair* findPairAndHash( const K& key, Hash& hash_out ) { hash_out = getKeyHash( key ); return findPair( key, hash_out ); }
+            template <typename K> Pair* findPairConst( const K& key, Hash hash ) const;
+            template <typename K> Pair* findPairConstAndHash( const K& key ) const { return findPairConst( key, getKeyHash( key ) ); }
+            template <typename K> bool getOrSetWithoutInitialization( K&& key, Pair*& pair_out );
+            template <typename K> bool getOrSetWithoutInitialization( K&& key, Hash hash, Pair*& pair_out );
+            Pair& insertPairWithoutInitialization( Hash hash );
+            void migrate( Size numBucketsToMigrate );
+            template <typename K> bool unsetPair( const K& key ) { return unsetPair( key, getKeyHash( key ) ); }
+            template <typename K> bool unsetPair( const K& key, Hash hash );
+            static void moveEntries( Bucket& sourceBucket, Bucket* buckets, Size numBuckets );
 
             static void releaseBuckets( Bucket* buckets, Size numBuckets );
 
-            HashMap( const HashMap<Key, Value, Hash, getHash, Size>& other );
-            HashMap<Key, Value, Hash, getHash, Size>& operator =( const HashMap<Key, Value, Hash, getHash, Size>& other );
+            HashMap( const li_this& other );
+            li_this& operator =( const li_this& other );
 
         public:
-            HashMap( Size shiftAmount = 2 );
-            HashMap( HashMap<Key, Value, Hash, getHash, Size>&& other );
+            HashMap( Size shiftAmount = 2, const THasher& hasher = THasher(), const TKeyEqual& keyEqual = TKeyEqual() );
+            HashMap( li_this&& other );
             ~HashMap();
-            HashMap<Key, Value, Hash, getHash, Size>& operator =( HashMap<Key, Value, Hash, getHash, Size>&& other );
+            li_this& operator =( li_this&& other );
 
             void clear();
-            Value* find( const Key& key );
-            Value get( const Key& key ) const;
+            // With a transparent hasher, lookups accept any key type it can hash (such as const char* for String)
+            // without building a Key. Other types are converted to Key first.
+            template <typename K> Value* find( const K& key );
+            template <typename K> Value get( const K& key ) const;
+
+            // Variants for a hash that the caller already computed with getKeyHash(), e.g. to probe several maps.
+            // The hash is only valid for maps whose hashers are equal (the default hashers share a per-process seed).
+            template <typename K> Value* find( const K& key, Hash hash );
+            template <typename K> Value get( const K& key, Hash hash ) const;
+
+            // Doesn't advance an incremental migration, so it is safe next to other const lookups (e.g. under a shared lock)
+            template <typename K> const Value* find( const K& key, Hash hash ) const;
+
+            template <typename K> Hash getKeyHash( const K& key ) const { return hasher( key ); }
+
+            static const Key& getLookupKey( const Key& key ) { return key; }
+            template <typename K, typename H = THasher> static auto getLookupKey( const K& key )
+                    -> decltype( typename H::is_transparent(), std::declval<const H&>()( key ), key ) { return key; }
+
             Iterator getIterator() { return Iterator( *this ); }
+            Size getNumEntries() const { return numEntries; }
+            bool isMigrating() const { return oldBuckets != nullptr; }
             void printStatistics();
             void resize( Size shiftAmount, bool lazy = false );
+
+            // Enables incremental resizing: when the map needs to grow, the old table is kept alive
+            // and every set/find/unset moves `bucketsPerStep` of its buckets over.
+            // This bounds the worst-case latency of a single insertion. 0 (default) resizes all at once.
+            void setIncrementalResize( Size bucketsPerStep ) { this->bucketsPerStep = bucketsPerStep; }
+
             Value& setEmpty( Key&& key );
             Value& set( Key&& key, Value&& value );
-            bool unset( Key&& key );
+
+            // The following hash the key exactly once and only copy or move it into the map when a new entry is created.
+            // K can be any type that Key can be constructed from and compared with.
+            template <typename K> Value& findOrInsert( K&& key );
+            template <typename K, typename V> Value& insertOrAssign( K&& key, V&& value );
+            template <typename K, typename... Args> std::pair<Value*, bool> tryEmplace( K&& key, Args&&... args );
+
+            // Same with a hash that the caller already computed with getKeyHash()
+            template <typename K, typename V> Value& insertOrAssign( K&& key, V&& value, Hash hash );
+            template <typename K, typename... Args> std::pair<Value*, bool> tryEmplaceWithHash( Hash hash, K&& key, Args&&... args );
+
+            template <typename K> bool unset( const K& key );
+            template <typename K> bool unset( const K& key, Hash hash );
     };
 
-#define li_member( type ) template<typename Key, typename Value, typename Hash, Hash ( *getHash )( const Key& ), typename Size> type li_this::
-#define li_member_ template<typename Key, typename Value, typename Hash, Hash ( *getHash )( const Key& ), typename Size> li_this::
+#define li_member( type ) template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator> type li_this::
+#define li_member_ template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator> li_this::
 
-    li_member_ HashMap( Size shiftAmount )
-            : buckets( nullptr ), numBuckets( 0 ), numEntries( 0 ), shiftAmount( 0 )
+    li_member_ HashMap( Size shiftAmount, const THasher& hasher, const TKeyEqual& keyEqual )
+            : buckets( nullptr ), numBuckets( 0 ), numEntries( 0 ), shiftAmount( 0 ),
+            oldBuckets( nullptr ), oldNumBuckets( 0 ), migrateIndex( 0 ), bucketsPerStep( 0 ),
+            hasher( hasher ), keyEqual( keyEqual )
     {
         resize( shiftAmount );
     }
 
-    li_member_ HashMap( HashMap<Key, Value, Hash, getHash, Size>&& other )
-            : buckets( other.buckets ), numBuckets( other.numBuckets ), numEntries( other.numEntries ), shiftAmount( other.shiftAmount )
+    li_member_ HashMap( li_this&& other )
+            : buckets( other.buckets ), numBuckets( other.numBuckets ), numEntries( other.numEntries ), shiftAmount( other.shiftAmount ),
+            oldBuckets( other.oldBuckets ), oldNumBuckets( other.oldNumBuckets ), migrateIndex( other.migrateIndex ), bucketsPerStep( other.bucketsPerStep ),
+            hasher( std::move( other.hasher ) ), keyEqual( std::move( other.keyEqual ) )
     {
         other.buckets = nullptr;
         other.numBuckets = 0;
         other.numEntries = 0;
         other.shiftAmount = 0;
+        other.oldBuckets = nullptr;
+        other.oldNumBuckets = 0;
+        other.migrateIndex = 0;
     }
 
     li_member_ ~HashMap()
@@ -131,8 +212,8 @@ namespace li
         clear();
     }
 
-    template<typename Key, typename Value, typename Hash, Hash ( *getHash )( const Key& ), typename Size>
-    HashMap<Key, Value, Hash, getHash, Size>& li_this::operator =( HashMap<Key, Value, Hash, getHash, Size>&& other )
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    li_this& li_this::operator =( li_this&& other )
     {
         clear();
 
@@ -140,28 +221,63 @@ namespace li
         numBuckets = other.numBuckets;
         numEntries = other.numEntries;
         shiftAmount = other.shiftAmount;
+        oldBuckets = other.oldBuckets;
+        oldNumBuckets = other.oldNumBuckets;
+        migrateIndex = other.migrateIndex;
+        bucketsPerStep = other.bucketsPerStep;
+        hasher = std::move( other.hasher );
+        keyEqual = std::move( other.keyEqual );
 
         other.buckets = nullptr;
         other.numBuckets = 0;
         other.numEntries = 0;
         other.shiftAmount = 0;
+        other.oldBuckets = nullptr;
+        other.oldNumBuckets = 0;
+        other.migrateIndex = 0;
 
         return *this;
     }
 
+    li_member( typename li_this::Bucket* ) allocateBuckets( Size numBuckets )
+    {
+        // allocate() zero-fills the array, which is exactly an array of empty buckets
+        return IAllocator<Bucket>::allocate( numBuckets );
+    }
+
+    li_member( typename li_this::Pair& ) appendToBucket( Bucket& bucket )
+    {
+        if ( bucket.numEntries + 1 >= bucket.capacity )
+        {
+            Size newCapacity = ( bucket.capacity == 0 ) ? 2 : bucket.capacity * 2;
+
+            //printf( "HashMap.add(): resizing bucket %u -> %u\n", bucket.capacity, newCapacity );
+
+            bucket.entries = IAllocator<Pair>::resize( bucket.entries, newCapacity );
+            bucket.capacity = newCapacity;
+        }
+
+        return bucket.entries[bucket.numEntries++];
+    }
+
     li_member( void ) clear()
     {
         releaseBuckets( buckets, numBuckets );
+        releaseBuckets( oldBuckets, oldNumBuckets );
 
         buckets = nullptr;
         numBuckets = 0;
         numEntries = 0;
         shiftAmount = 0;
+        oldBuckets = nullptr;
+        oldNumBuckets = 0;
+        migrateIndex = 0;
     }
 
-    li_member( Value* ) find( const Key& key )
+    li_member( template <typename K> Value* ) find( const K& key )
     {
-        Pair* pair = findPair( key );
+        Hash hash;
+        Pair* pair = findPairAndHash( getLookupKey( key ), hash );
 
         if ( pair != nullptr )
             return &pair->value;
@@ -169,71 +285,237 @@ namespace li
             return nullptr;
     }
 
-    li_member( typename li_this::Pair* ) findPair( const Key& key )
+    li_member( template <typename K> Value* ) find( const K& key, Hash hash )
+    {
+        Pair* pair = findPair( key, hash );
+
+        if ( pair != nullptr )
+            return &pair->value;
+        else
+            return nullptr;
+    }
+
+    li_member( template <typename K> const Value* ) find( const K& key, Hash hash ) const
+    {
+        const Pair* pair = findPairConst( key, hash );
+
+        if ( pair != nullptr )
+            return &pair->value;
+        else
+            return nullptr;
+    }
+
+    li_member( void ) finishMigration()
+    {
+        if ( oldBuckets != nullptr )
+            migrate( oldNumBuckets );
+    }
+
+    li_member( template <typename K> Value& ) findOrInsert( K&& key )
     {
-        Hash hash = getHash( key );
+        Pair* pair;
+
+        if ( getOrSetWithoutInitialization( std::forward<K>( key ), pair ) )
+            constructPointer( &pair->value );
+
+        return pair->value;
+    }
+
+    li_member( template <typename K> typename li_this::Pair* ) findPair( const K& key, Hash hash )
+    {
+        if ( oldBuckets != nullptr )
+            migrate( bucketsPerStep );
+
+        return findPairConst( key, hash );
+    }
+
+    li_member( template <typename K> typename li_this::Pair* ) findPairConst( const K& key, Hash hash ) const
+    {
+        if ( numBuckets == 0 )
+            return nullptr;
+
         Bucket& bucket = buckets[hash & ( numBuckets - 1 )];
 
         for ( Size i = 0; i < bucket.numEntries; i++ )
-            if ( bucket.entries[i].hash == hash && bucket.entries[i].key == key )
+            if ( bucket.entries[i].hash == hash && keyEqual( bucket.entries[i].key, key ) )
                 return &bucket.entries[i];
 
+        if ( oldBuckets != nullptr )
+        {
+            Bucket& oldBucket = oldBuckets[hash & ( oldNumBuckets - 1 )];
+
+            for ( Size i = 0; i < oldBucket.numEntries; i++ )
+                if ( oldBucket.entries[i].hash == hash && keyEqual( oldBucket.entries[i].key, key ) )
+                    return &oldBucket.entries[i];
+        }
+
         return nullptr;
     }
 
-    li_member( Value ) get( const Key& key ) const
+    li_member( template <typename K> Value ) get( const K& key ) const
     {
-        Hash hash = getHash( key );
-        Bucket& bucket = buckets[hash & ( numBuckets - 1 )];
+        const Pair* pair = findPairConstAndHash( getLookupKey( key ) );
 
-        for ( Size i = 0; i < bucket.numEntries; i++ )
-            if ( bucket.entries[i].hash == hash && bucket.entries[i].key == key )
-                return bucket.entries[i].value;
+        if ( pair != nullptr )
+            return pair->value;
+        else
+            return 0;
+    }
+
+    li_member( template <typename K> Value ) get( const K& key, Hash hash ) const
+    {
+        const Pair* pair = findPairConst( key, hash );
 
-        return 0;
+        if ( pair != nullptr )
+            return pair->value;
+        else
+            return 0;
     }
 
-    li_member( bool ) getOrSetWithoutInitialization( Key&& key, Pair*& pair_out )
+    li_member( template <typename K> bool ) getOrSetWithoutInitialization( K&& key, Pair*& pair_out )
     {
-        //printf( "HashMap.set(): %u entries, %u buckets (%u/%u)\n", numEntries, numBuckets, numEntries, numBuckets * 4 );
+        // The same hash is used both for the lookup and for the insertion
+        Hash hash;
 
-        pair_out = findPair( key );
+        pair_out = findPairAndHash( getLookupKey( key ), hash );
 
         if ( pair_out != nullptr )
             return false;
 
+        pair_out = &insertPairWithoutInitialization( hash );
+        constructPointer( &pair_out->key, std::forward<K>( key ) );
+        return true;
+    }
+
+    li_member( template <typename K> bool ) getOrSetWithoutInitialization( K&& key, Hash hash, Pair*& pair_out )
+    {
+        pair_out = findPair( getLookupKey( key ), hash );
+
+        if ( pair_out != nullptr )
+            return false;
+
+        pair_out = &insertPairWithoutInitialization( hash );
+        constructPointer( &pair_out->key, std::forward<K>( key ) );
+        return true;
+    }
+
+    li_member( typename li_this::Pair& ) insertPairWithoutInitialization( Hash hash )
+    {
+        //printf( "HashMap.set(): %u entries, %u buckets (%u/%u)\n", numEntries, numBuckets, numEntries, numBuckets * 4 );
+
         if ( numEntries + 1 > numBuckets * 4 )
-            resize( shiftAmount + 2, false );
+        {
+            if ( bucketsPerStep > 0 )
+            {
+                // Finish any migration still in progress, then start migrating into a 4x larger table
+                finishMigration();
+
+                oldBuckets = buckets;
+                oldNumBuckets = numBuckets;
+                migrateIndex = 0;
+
+                shiftAmount += 2;
+                numBuckets = ( 1 << shiftAmount );
+                buckets = allocateBuckets( numBuckets );
+
+                migrate( bucketsPerStep );
+            }
+            else
+                resize( shiftAmount + 2, false );
+        }
 
-        Hash hash = getHash( key );
         Bucket& bucket = buckets[hash & ( numBuckets - 1 )];
 
         //printf( "HashMap.add(): Hash = %08X, bucket = %u\n", hash, hash & ( numBuckets - 1 ) );
 
-        if ( bucket.numEntries + 1 >= bucket.capacity )
+        Pair& pair = appendToBucket( bucket );
+        numEntries++;
+
+        constructPointer( &pair.hash, std::forward<Hash>( hash ) );
+        return pair;
+    }
+
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    template <typename K, typename V> Value& li_this::insertOrAssign( K&& key, V&& value )
+    {
+        Pair* pair;
+
+        if ( !getOrSetWithoutInitialization( std::forward<K>( key ), pair ) )
         {
-            Size newCapacity = ( bucket.capacity == 0 ) ? 2 : bucket.capacity * 2;
+            pair->value = std::forward<V>( value );
+            return pair->value;
+        }
 
-            //printf( "HashMap.add(): resizing bucket %u -> %u\n", bucket.capacity, newCapacity );
+        constructPointer( &pair->value, std::forward<V>( value ) );
+        return pair->value;
+    }
 
-            bucket.entries = Allocator<Pair>::resize( bucket.entries, newCapacity );
-            bucket.capacity = newCapacity;
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    template <typename K, typename V> Value& li_this::insertOrAssign( K&& key, V&& value, Hash hash )
+    {
+        Pair* pair;
+
+        if ( !getOrSetWithoutInitialization( std::forward<K>( key ), hash, pair ) )
+        {
+            pair->value = std::forward<V>( value );
+            return pair->value;
         }
 
-        bucket.numEntries++;
-        numEntries++;
+        constructPointer( &pair->value, std::forward<V>( value ) );
+        return pair->value;
+    }
 
-        constructPointer( &bucket.entries[bucket.numEntries - 1].key, std::forward<Key>( key ) );
-        constructPointer( &bucket.entries[bucket.numEntries - 1].hash, std::forward<Hash>( hash ) );
+    li_member( void ) migrate( Size numBucketsToMigrate )
+    {
+        for ( ; numBucketsToMigrate > 0 && migrateIndex < oldNumBuckets; numBucketsToMigrate-- )
+        {
+            Bucket& sourceBucket = oldBuckets[migrateIndex++];
 
-        pair_out = &bucket.entries[bucket.numEntries - 1];
-        return true;
+            moveEntries( sourceBucket, buckets, numBuckets );
+
+            IAllocator<Pair>::release( sourceBucket.entries );
+            sourceBucket.entries = nullptr;
+            sourceBucket.numEntries = 0;
+            sourceBucket.capacity = 0;
+        }
+
+        if ( migrateIndex == oldNumBuckets )
+        {
+            IAllocator<Bucket>::release( oldBuckets );
+
+            oldBuckets = nullptr;
+            oldNumBuckets = 0;
+            migrateIndex = 0;
+        }
+    }
+
+    li_member( void ) moveEntries( Bucket& sourceBucket, Bucket* buckets, Size numBuckets )
+    {
+        // Re-insert the entries using the already computed hashes and leave the source destructed
+        for ( Size j = 0; j < sourceBucket.numEntries; j++ )
+        {
+            Pair& source = sourceBucket.entries[j];
+            Pair& pair = appendToBucket( buckets[source.hash & ( numBuckets - 1 )] );
+
+            constructPointer( &pair.key,   std::move( source.key ) );
+            constructPointer( &pair.value, std::move( source.value ) );
+            constructPointer( &pair.hash,  std::move( source.hash ) );
+
+            destructPointer( &source.key );
+            destructPointer( &source.value );
+            destructPointer( &source.hash );
+        }
+
+        sourceBucket.numEntries = 0;
     }
 
     li_member( void ) printStatistics()
     {
         printf( "HashMap: %" PRIuPTR " buckets (shift = %" PRIuPTR "); %" PRIuPTR " entries\n", ( size_t ) this->numBuckets, ( size_t ) this->shiftAmount, ( size_t ) this->numEntries );
 
+        if ( oldBuckets != nullptr )
+            printf( "  (migrating from %" PRIuPTR " buckets, %" PRIuPTR " done)\n", ( size_t ) oldNumBuckets, ( size_t ) migrateIndex );
+
         for ( Size i = 0; i < numBuckets; i++ )
         {
             const Bucket& bucket = buckets[i];
@@ -241,7 +523,7 @@ namespace li
             printf( "  - bucket #%04X (%" PRIuPTR "/%" PRIuPTR " entries)\n", ( uint16_t ) i, ( size_t ) bucket.numEntries, ( size_t ) bucket.capacity );
 
             for ( Size j = 0; j < bucket.numEntries; j++ )
-                printf( "      - entry #%" PRIuPTR " (hash = %08" PRIXPTR ")\n", ( size_t ) j, bucket.entries[j].hash );
+                printf( "      - entry #%" PRIuPTR " (hash = %08" PRIXPTR ")\n", ( size_t ) j, ( size_t ) bucket.entries[j].hash );
         }
     }
 
@@ -258,14 +540,16 @@ namespace li
                 destructPointer( &bucket.entries[j].hash );
             }
 
-            Allocator<Pair>::release( bucket.entries );
+            IAllocator<Pair>::release( bucket.entries );
         }
 
-        Allocator<Bucket>::release( buckets );
+        IAllocator<Bucket>::release( buckets );
     }
 
     li_member( void ) resize( Size shiftAmount, bool lazy )
     {
+        finishMigration();
+
         if ( shiftAmount == this->shiftAmount )
             return;
 
@@ -274,114 +558,109 @@ namespace li
         if ( lazy && numBuckets < this->numBuckets )
             return;
 
-        if ( buckets == nullptr )
-        {
-            buckets = Allocator<Bucket>::allocate( numBuckets );
-
-            for ( Size i = 0; i < numBuckets; i++ )
-            {
-                buckets[i].entries = nullptr;
-                buckets[i].numEntries = 0;
-                buckets[i].capacity = 0;
-            }
+        // Allocate new bucket array (we're starting from scratch)
+        Bucket* buckets = allocateBuckets( numBuckets );
 
-            this->numBuckets = numBuckets;
-            this->shiftAmount = shiftAmount;
-        }
-        else
-        {
-            // Allocate new bucket array
-            Bucket* buckets = Allocator<Bucket>::allocate( numBuckets );
+        // Now re-insert the original entries
+        for ( Size i = 0; i < this->numBuckets; i++ )
+            moveEntries( this->buckets[i], buckets, numBuckets );
 
-            // Init the new bucket array (we're starting from scratch)
-            for ( Size i = 0; i < numBuckets; i++ )
-            {
-                buckets[i].entries = nullptr;
-                buckets[i].numEntries = 0;
-                buckets[i].capacity = 0;
-            }
+        releaseBuckets( this->buckets, this->numBuckets );
 
-            // Now re-insert the original entries using the already computed hashes
-            for ( Size i = 0; i < this->numBuckets; i++ )
-            {
-                Bucket& sourceBucket = this->buckets[i];
-
-                for ( Size j = 0; j < sourceBucket.numEntries; j++ )
-                {
-                    Hash hash = sourceBucket.entries[j].hash;
-                    Bucket& bucket = buckets[hash & ( numBuckets - 1 )];
+        this->buckets = buckets;
+        this->numBuckets = numBuckets;
+        this->shiftAmount = shiftAmount;
+    }
 
-                    if ( bucket.numEntries + 1 >= bucket.capacity )
-                    {
-                        Size newCapacity = ( bucket.capacity == 0 ) ? 2 : bucket.capacity * 2;
-                        bucket.entries = Allocator<Pair>::resize( bucket.entries, newCapacity );
-                        bucket.capacity = newCapacity;
-                    }
+    li_member( Value& ) set( Key&& key, Value&& value )
+    {
+        return insertOrAssign( std::move( key ), std::move( value ) );
+    }
 
-                    constructPointer( &bucket.entries[bucket.numEntries].key,   std::move( sourceBucket.entries[j].key ) );
-                    constructPointer( &bucket.entries[bucket.numEntries].value, std::move( sourceBucket.entries[j].value ) );
-                    constructPointer( &bucket.entries[bucket.numEntries].hash,  std::move( sourceBucket.entries[j].hash ) );
+    li_member( Value& ) setEmpty( Key&& key )
+    {
+        return findOrInsert( std::move( key ) );
+    }
 
-                    bucket.numEntries++;
-                }
-            }
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    template <typename K, typename... Args> std::pair<Value*, bool> li_this::tryEmplace( K&& key, Args&&... args )
+    {
+        Pair* pair;
 
-            releaseBuckets( this->buckets, this->numBuckets );
+        if ( !getOrSetWithoutInitialization( std::forward<K>( key ), pair ) )
+            return std::pair<Value*, bool>( &pair->value, false );
 
-            this->buckets = buckets;
-            this->numBuckets = numBuckets;
-            this->shiftAmount = shiftAmount;
-        }
+        new( static_cast<void*>( &pair->value ) ) Value( std::forward<Args>( args )... );
+        return std::pair<Value*, bool>( &pair->value, true );
     }
 
-    li_member( Value& ) set( Key&& key, Value&& value )
+    template<typename Key, typename Value, class THasher, class TKeyEqual, typename Size, template <typename> class IAllocator>
+    template <typename K, typename... Args> std::pair<Value*, bool> li_this::tryEmplaceWithHash( Hash hash, K&& key, Args&&... args )
     {
         Pair* pair;
 
-        if ( !getOrSetWithoutInitialization( std::forward<Key>( key ), pair ) )
-        {
-            pair->value = std::move( value );
-            return pair->value;
-        }
+        if ( !getOrSetWithoutInitialization( std::forward<K>( key ), hash, pair ) )
+            return std::pair<Value*, bool>( &pair->value, false );
 
-        constructPointer( &pair->value, std::move( value ) );
-        return pair->value;
+        new( static_cast<void*>( &pair->value ) ) Value( std::forward<Args>( args )... );
+        return std::pair<Value*, bool>( &pair->value, true );
     }
 
-    li_member( Value& ) setEmpty( Key&& key )
+    li_member( template <typename K> bool ) unset( const K& key )
     {
-        Pair* pair;
-        
-        if ( !getOrSetWithoutInitialization( std::forward<Key>( key ), pair ) )
-            return pair->value;
+        return unsetPair( getLookupKey( key ) );
+    }
 
-        constructPointer( &pair->value );
-        return pair->value;
+    li_member( template <typename K> bool ) unset( const K& key, Hash hash )
+    {
+        return unsetPair( getLookupKey( key ), hash );
     }
 
-    li_member( bool ) unset( Key&& key )
+    li_member( template <typename K> bool ) unsetPair( const K& key, Hash hash )
     {
-        Hash hash = getHash( key );
-        Bucket& bucket = buckets[hash & ( numBuckets - 1 )];
-        
-        for ( Size i = 0; i < bucket.numEntries; i++ )
-            if ( bucket.entries[i].hash == hash && bucket.entries[i].key == key )
-            {
-                destructPointer( &bucket.entries[i].key );
-                destructPointer( &bucket.entries[i].value );
-                destructPointer( &bucket.entries[i].hash );
-                
-                memmove(&bucket.entries[i], &bucket.entries[i + 1], (bucket.numEntries - i - 1) * sizeof(Pair));
-                
-                bucket.numEntries--;
-                numEntries--;
-                
-                return true;
-            }
-        
+        if ( oldBuckets != nullptr )
+            migrate( bucketsPerStep );
+
+        if ( numBuckets == 0 )
+            return false;
+
+        for ( int table = 0; table < 2; table++ )
+        {
+            Bucket* tableBuckets = ( table == 0 ) ? buckets : oldBuckets;
+            Size tableNumBuckets = ( table == 0 ) ? numBuckets : oldNumBuckets;
+
+            if ( tableBuckets == nullptr )
+                break;
+
+            Bucket& bucket = tableBuckets[hash & ( tableNumBuckets - 1 )];
+
+            for ( Size i = 0; i < bucket.numEntries; i++ )
+                if ( bucket.entries[i].hash == hash && keyEqual( bucket.entries[i].key, key ) )
+                {
+                    // Order within a bucket doesn't matter, so fill the hole with the last entry
+                    Pair& last = bucket.entries[bucket.numEntries - 1];
+
+                    if ( &bucket.entries[i] != &last )
+                    {
+                        bucket.entries[i].key = std::move( last.key );
+                        bucket.entries[i].value = std::move( last.value );
+                        bucket.entries[i].hash = last.hash;
+                    }
+
+                    destructPointer( &last.key );
+                    destructPointer( &last.value );
+                    destructPointer( &last.hash );
+
+                    bucket.numEntries--;
+                    numEntries--;
+
+                    return true;
+                }
+        }
+
         return false;
     }
-    
+
 #undef li_member
 #undef li_member_
 
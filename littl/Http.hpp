@@ -117,7 +117,10 @@ namespace li
 
         std::unique_ptr<TcpSocket> session;
         HttpRequest* currentRequest;
+
+        // Requests before queueHead have been dequeued already
         List<HttpRequest*> queue;
+        size_t queueHead;
 
         size_t bufferSize;
 
@@ -41,6 +41,18 @@ namespace li
     class List : public li_base
     {
         protected:
+            void copyItems( TLength field, const T* items, TLength count )
+            {
+                if constexpr ( std::is_trivially_copyable<T>::value )
+                {
+                    if ( count > 0 )
+                        memcpy( this->getPtrUnsafe( field ), items, count * sizeof( T ) );
+                }
+                else
+                    for ( TLength i = 0; i < count; i++ )
+                        this->getUnsafe( field + i ) = items[i];
+            }
+
         public:
             TLength length;
 
@@ -62,6 +74,7 @@ namespace li
 
                     size_t getIndex() const { return i; }
                     bool isValid() const { return i >= 0 && static_cast<size_t>( i ) < list.getLength(); }
+                    // O(n) per call; prefer List::removeIf when removing many items
                     void remove() { list.remove(i--); }
 
                     Iterator& operator = ( T&& value )
@@ -168,21 +181,43 @@ namespace li
 
             TLength add( T&& item )
             {
-                this->resize( length + 1, true );
+                this->grow( length + 1 );
                 this->getUnsafe( length ) = std::move( item );
                 return length++;
             }
 
             TLength add( const T& item )
             {
-                this->resize( length + 1, true );
+                this->grow( length + 1 );
                 this->getUnsafe( length ) = item;
                 return length++;
             }
 
+            // Copies count items; `items` must not point into this list
+            void addRange( const T* items, TLength count )
+            {
+                this->grow( length + count );
+                copyItems( length, items, count );
+                length += count;
+            }
+
+            void addRange( const li_this& other )
+            {
+                if ( &other == this )
+                {
+                    // grow() may move the items, so copy from the new buffer
+                    const TLength count = length;
+                    this->grow( length + count );
+                    copyItems( length, this->getPtrUnsafe(), count );
+                    length += count;
+                }
+                else
+                    addRange( other.getPtrUnsafe(), other.getLength() );
+            }
+
             T& addEmpty()
             {
-                this->resize( length + 1, true );
+                this->grow( length + 1 );
                 return this->get( length++ );
             }
 
@@ -198,6 +233,31 @@ namespace li
                 length = 0;
             }
 
+            // Constructs the new item in place
+            template <typename... Args>
+            T& emplace( Args&&... args )
+            {
+                this->grow( length + 1 );
+
+                // Slots past the end hold default-constructed items, which the Array will destroy eventually;
+                // if the constructor throws, put one back so that it isn't destroyed twice
+                T* item = this->getPtrUnsafe( length );
+                destructPointer( item );
+
+                try
+                {
+                    new ( static_cast<void*>( item ) ) T( std::forward<Args>( args )... );
+                }
+                catch ( ... )
+                {
+                    constructPointer( item );
+                    throw;
+                }
+
+                length++;
+                return *item;
+            }
+
             void deleteAllItems()
             {
                 for ( TLength i = 0; i < length; i++ )
@@ -268,6 +328,7 @@ namespace li
             {
                 if ( field < length )
                 {
+                    this->grow( length + 1 );
                     this->move( field + 1, field, length - field );
                     this->getUnsafe( field ) = item;
                     length++;
@@ -281,6 +342,7 @@ namespace li
             {
                 if ( field < length )
                 {
+                    this->grow( length + 1 );
                     this->move( field + 1, field, length - field );
                     length++;
                     return this->getUnsafe( field );
@@ -289,6 +351,21 @@ namespace li
                     return addEmpty();
             }
 
+            // Copies count items to [field, field + count); `items` must not point into this list
+            void insertRange( const T* items, TLength count, TLength field )
+            {
+                if ( field >= length )
+                {
+                    addRange( items, count );
+                    return;
+                }
+
+                this->grow( length + count );
+                this->move( field + count, field, length - field );
+                copyItems( field, items, count );
+                length += count;
+            }
+
             bool isEmpty() const
             {
                 return length == 0;
@@ -334,6 +411,47 @@ namespace li
                 remove( length - field, count );
             }
 
+            // Removes all items matching the predicate in a single pass, keeping the order of the rest.
+            // Use this instead of remove( i ) in a loop, which is quadratic.
+            template <typename Predicate>
+            TLength removeIf( Predicate predicate )
+            {
+                TLength kept = 0;
+
+                for ( TLength i = 0; i < length; i++ )
+                {
+                    T& item = this->getUnsafe( i );
+
+                    if ( !predicate( item ) )
+                    {
+                        if ( kept != i )
+                            this->getUnsafe( kept ) = std::move( item );
+
+                        kept++;
+                    }
+                }
+
+                // Leave the vacated slots default-constructed, as remove() does
+                for ( TLength i = kept; i < length; i++ )
+                    this->getUnsafe( i ) = T();
+
+                const TLength removed = length - kept;
+                length = kept;
+                return removed;
+            }
+
+            // O(1) removal which moves the last item into the gap
+            void removeUnordered( TLength field )
+            {
+                if ( field >= length )
+                    return;
+
+                if ( field != length - 1 )
+                    this->getUnsafe( field ) = std::move( this->getUnsafe( length - 1 ) );
+
+                this->getUnsafe( --length ) = T();
+            }
+
             bool removeItem( const T& item )
             {
                 for ( TLength i = 0; i < length; i++ )
@@ -346,6 +464,18 @@ namespace li
                 return false;
             }
 
+            // Keeps only the items matching the predicate
+            template <typename Predicate>
+            TLength retain( Predicate predicate )
+            {
+                return removeIf( [&predicate]( T& item ) { return !predicate( item ); } );
+            }
+
+            void shrinkToFit()
+            {
+                this->resize( length );
+            }
+
             void setLength( size_t length, bool lazy = false )
             {
                 this->resize(length, lazy);
@@ -426,6 +556,11 @@ namespace li
             }
     };
 
+    template<typename T, typename TLength, class IAllocator, int options>
+    struct IsTriviallyRelocatable<li_this> : std::true_type
+    {
+    };
+
 #undef li_base
 #undef li_this
 }
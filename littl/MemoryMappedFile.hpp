@@ -23,18 +23,35 @@
 
 #pragma once
 
-#include <littl/BaseIO.hpp>
+#include <littl/Stream.hpp>
+
+#include <cstring>
+#include <memory>
 
 #ifndef __li_MSW
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace li
 {
+    // File mapped into memory. open() maps the whole file; for files larger than the address space
+    // can hold, map() a window at a time instead. The view stays valid until the next map()/unmap().
     class MemoryMappedFile
     {
+        public:
+            enum Advice
+            {
+                adviseNormal,
+                adviseSequential,
+                adviseRandom,
+                adviseWillNeed,
+                adviseHugePages
+            };
+
         protected:
 #ifdef __li_MSW
             HANDLE hFile, hFileMapping;
@@ -42,54 +59,315 @@ namespace li
             int fd;
 #endif
 
+            bool writable;
+            FileSize size;
+
+            // The mapping itself starts at a page/granularity boundary at or below the view
+            uint8_t* mapBase;
+            size_t mapLength;
+
+            uint8_t* view;
+            FilePos viewOffset;
+            size_t viewLength;
+
         private:
-            MemoryMappedFile() {}
+            MemoryMappedFile() : writable( false ), size( 0 ), mapBase( nullptr ), mapLength( 0 ), view( nullptr ), viewOffset( 0 ), viewLength( 0 ) {}
             MemoryMappedFile( const MemoryMappedFile& );
 
+            static size_t getGranularity()
+            {
+#ifdef __li_MSW
+                SYSTEM_INFO info;
+                GetSystemInfo( &info );
+                return info.dwAllocationGranularity;
+#else
+                return static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+#endif
+            }
+
         public:
-            static MemoryMappedFile* open( const char* fileName, bool forWriting = false )
+            // With `forWriting`, the file is opened (and created if necessary) for a read-write mapping.
+            // A non-zero `newSize` resizes the file first, which is the only way to map a new file.
+            static MemoryMappedFile* open( const char* fileName, bool forWriting = false, FileSize newSize = 0 )
             {
 #ifdef __li_MSW
                 // FIXME: Replace slashes in path with backslashes
                 // TODO: Unicode support
                 HANDLE hFile = CreateFileA( fileName, forWriting ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, NULL,
-                        forWriting ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+                        forWriting ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
 
                 if ( hFile == INVALID_HANDLE_VALUE )
                     return nullptr;
 
-                HANDLE hFileMapping = CreateFileMapping( hFile, NULL, forWriting ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL );
+                LARGE_INTEGER fileSize;
+
+                if ( forWriting && newSize > 0 )
+                {
+                    fileSize.QuadPart = newSize;
+
+                    if ( !SetFilePointerEx( hFile, fileSize, NULL, FILE_BEGIN ) || !SetEndOfFile( hFile ) )
+                    {
+                        CloseHandle( hFile );
+                        return nullptr;
+                    }
+                }
 
-                if ( hFileMapping == NULL )
+                if ( !GetFileSizeEx( hFile, &fileSize ) )
                 {
                     CloseHandle( hFile );
                     return nullptr;
                 }
 
+                // Empty files can't be mapped
+                HANDLE hFileMapping = NULL;
+
+                if ( fileSize.QuadPart > 0 )
+                {
+                    hFileMapping = CreateFileMapping( hFile, NULL, forWriting ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL );
+
+                    if ( hFileMapping == NULL )
+                    {
+                        CloseHandle( hFile );
+                        return nullptr;
+                    }
+                }
+
                 MemoryMappedFile* mmf = new MemoryMappedFile;
                 mmf->hFile = hFile;
                 mmf->hFileMapping = hFileMapping;
-                return mmf;
+                mmf->size = fileSize.QuadPart;
 #else
-                int fd = ::open( fileName, forWriting ? ( O_CREAT | O_WRONLY | O_TRUNC ) : O_RDONLY, 0644 );
+                int fd = ::open( fileName, forWriting ? ( O_CREAT | O_RDWR ) : O_RDONLY, 0644 );
 
                 if (fd == -1)
                     return nullptr;
 
+                struct stat st;
+
+                if ( ( forWriting && newSize > 0 && ftruncate( fd, newSize ) != 0 ) || fstat( fd, &st ) != 0 )
+                {
+                    close(fd);
+                    return nullptr;
+                }
+
                 MemoryMappedFile* mmf = new MemoryMappedFile;
                 mmf->fd = fd;
-                return mmf;
+                mmf->size = st.st_size;
 #endif
+
+                mmf->writable = forWriting;
+
+                // Failing to map everything (e.g. a huge file in a 32-bit process) still leaves map() usable
+                if ( mmf->size > 0 && mmf->size <= static_cast<FileSize>( SIZE_MAX ) )
+                    mmf->map( 0, static_cast<size_t>( mmf->size ) );
+
+                return mmf;
             }
 
             ~MemoryMappedFile()
             {
+                unmap();
+
 #ifdef __li_MSW
-                CloseHandle(hFileMapping);
+                if (hFileMapping != NULL)
+                    CloseHandle(hFileMapping);
+
                 CloseHandle(hFile);
 #else
                 close(fd);
 #endif
             }
+
+            // Requests the operating system to write back modified pages of the view.
+            // With `async`, only schedules the write-back.
+            bool flush( bool async = true )
+            {
+                if ( view == nullptr || !writable )
+                    return true;
+
+#ifdef __li_MSW
+                return FlushViewOfFile( mapBase, mapLength ) && ( async || FlushFileBuffers( hFile ) );
+#else
+                return msync( mapBase, mapLength, async ? MS_ASYNC : MS_SYNC ) == 0;
+#endif
+            }
+
+            // Hints the expected access pattern for `length` bytes (0 = to the end) of the view starting at `offset`
+            bool advise( Advice advice, size_t offset = 0, size_t length = 0 )
+            {
+                if ( view == nullptr || offset > viewLength )
+                    return false;
+
+                if ( length == 0 || length > viewLength - offset )
+                    length = viewLength - offset;
+
+#ifdef __li_MSW
+                return advice == adviseNormal;
+#else
+                int flag;
+
+                switch ( advice )
+                {
+                    case adviseNormal:      flag = MADV_NORMAL; break;
+                    case adviseSequential:  flag = MADV_SEQUENTIAL; break;
+                    case adviseRandom:      flag = MADV_RANDOM; break;
+                    case adviseWillNeed:    flag = MADV_WILLNEED; break;
+#ifdef MADV_HUGEPAGE
+                    case adviseHugePages:   flag = MADV_HUGEPAGE; break;
+#endif
+                    default:                return false;
+                }
+
+                // madvise wants a page-aligned start
+                uint8_t* begin = view + offset;
+                size_t alignment = static_cast<size_t>( begin - mapBase ) % getGranularity();
+
+                return madvise( begin - alignment, length + alignment, flag ) == 0;
+#endif
+            }
+
+            uint8_t* getData() { return view; }
+            const uint8_t* getData() const { return view; }
+            FileSize getSize() const { return size; }
+            FilePos getViewOffset() const { return viewOffset; }
+            size_t getViewLength() const { return viewLength; }
+            bool isWritable() const { return writable; }
+
+            // Maps `length` bytes (0 = to the end of the file) starting at `offset`, replacing the current view
+            bool map( FilePos offset, size_t length = 0 )
+            {
+                unmap();
+
+                if ( offset >= size )
+                    return false;
+
+                if ( length == 0 || length > size - offset )
+                {
+                    if ( size - offset > static_cast<FileSize>( SIZE_MAX ) )
+                        return false;
+
+                    length = static_cast<size_t>( size - offset );
+                }
+
+                size_t alignment = static_cast<size_t>( offset % getGranularity() );
+                FilePos mapOffset = offset - alignment;
+                size_t mapLength = length + alignment;
+
+#ifdef __li_MSW
+                void* base = MapViewOfFile( hFileMapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                        static_cast<DWORD>( mapOffset >> 32 ), static_cast<DWORD>( mapOffset ), mapLength );
+
+                if ( base == nullptr )
+                    return false;
+#else
+                void* base = mmap( nullptr, mapLength, writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ, MAP_SHARED, fd, mapOffset );
+
+                if ( base == MAP_FAILED )
+                    return false;
+#endif
+
+                this->mapBase = reinterpret_cast<uint8_t*>( base );
+                this->mapLength = mapLength;
+                view = mapBase + alignment;
+                viewOffset = offset;
+                viewLength = length;
+                return true;
+            }
+
+            void unmap()
+            {
+                if ( mapBase == nullptr )
+                    return;
+
+#ifdef __li_MSW
+                UnmapViewOfFile( mapBase );
+#else
+                munmap( mapBase, mapLength );
+#endif
+
+                mapBase = nullptr;
+                mapLength = 0;
+                view = nullptr;
+                viewOffset = 0;
+                viewLength = 0;
+            }
+    };
+
+    // Reads the current view of a MemoryMappedFile without any system calls or copies:
+    // getPtr() hands out the bytes in place, and read() is a plain memcpy.
+    // The stream covers only the view mapped at construction (not the whole file, unless that's what is mapped),
+    // so nobody may map() or unmap() the file while the stream exists; it only hands out const access itself.
+    class MappedInputStream : public InputStream
+    {
+        std::shared_ptr<const MemoryMappedFile> file;
+        const uint8_t* data;
+        size_t length, pos;
+
+        MappedInputStream( const MappedInputStream& );
+
+        public:
+            MappedInputStream( std::shared_ptr<const MemoryMappedFile> file )
+                    : file( std::move( file ) ), pos( 0 )
+            {
+                data = this->file->getData();
+                length = this->file->getViewLength();
+            }
+
+            static MappedInputStream* open( const char* fileName )
+            {
+                std::shared_ptr<MemoryMappedFile> file( MemoryMappedFile::open( fileName ) );
+
+                // Empty files have no view, but are perfectly readable
+                if ( file == nullptr || ( file->getData() == nullptr && file->getSize() > 0 ) )
+                    return nullptr;
+
+                return new MappedInputStream( std::move( file ) );
+            }
+
+            virtual bool finite() override { return true; }
+            virtual bool seekable() override { return true; }
+
+            virtual void flush() override {}
+            virtual const char* getErrorDesc() override { return nullptr; }
+
+            virtual FilePos getPos() override { return pos; }
+            virtual bool setPos( FilePos pos ) override { this->pos = ( pos < length ) ? static_cast<size_t>( pos ) : length; return pos <= length; }
+            virtual FileSize getSize() override { return length; }
+
+            virtual bool eof() override { return pos >= length; }
+
+            virtual size_t read( void* out, size_t count ) override
+            {
+                if ( count > length - pos )
+                    count = length - pos;
+
+                if ( count == 0 )
+                    return 0;
+
+                memcpy( out, data + pos, count );
+                pos += count;
+                return count;
+            }
+
+            const uint8_t* getData() const { return data; }
+            const std::shared_ptr<const MemoryMappedFile>& getFile() const { return file; }
+
+            // Pointer to the next unread byte; valid for getRemaining() bytes
+            const uint8_t* getPtr() const { return data + pos; }
+            size_t getRemaining() const { return length - pos; }
+
+            // Consumes up to `count` bytes, returning a pointer to them (or nullptr at the end)
+            const uint8_t* readInPlace( size_t& count )
+            {
+                if ( count > length - pos )
+                    count = length - pos;
+
+                if ( count == 0 )
+                    return nullptr;
+
+                const uint8_t* ptr = data + pos;
+                pos += count;
+                return ptr;
+            }
     };
 }
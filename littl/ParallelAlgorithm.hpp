@@ -0,0 +1,477 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/Algorithm.hpp>
+#include <littl/List.hpp>
+#include <littl/Thread.hpp>
+
+// Parallel variants of the algorithms in Algorithm.hpp. Each splits the range into one contiguous chunk
+// per thread; the calling thread always works on the first chunk, so `numThreads` includes it.
+// Kept in a separate header so that Algorithm.hpp stays free of threading.
+
+namespace li
+{
+    namespace ParallelDetail
+    {
+        // Item type of a List-like container
+        template <class Container>
+        using ItemType = typename std::decay<decltype( *std::declval<const Container&>().getPtrUnsafe() )>::type;
+
+        // Ranges smaller than this aren't worth starting threads for
+        enum { minItemsPerThread = 8192 };
+
+        template <class Function>
+        class Worker : public Thread
+        {
+            Function& function;
+            unsigned index;
+
+            protected:
+                virtual void run() override { function( index ); }
+
+            public:
+                Worker( Function& function, unsigned index ) : function( function ), index( index ) {}
+        };
+
+        // Calls function( 0 ) .. function( numTasks - 1 ) concurrently and waits for all of them.
+        // A task whose thread fails to start is simply run on the calling thread.
+        template <class Function>
+        void runTasks( unsigned numTasks, Function function )
+        {
+            List<Worker<Function>*> workers;
+
+            for ( unsigned i = 1; i < numTasks; i++ )
+            {
+                auto worker = new Worker<Function>( function, i );
+
+                if ( worker->start() )
+                    workers.add( worker );
+                else
+                {
+                    delete worker;
+                    function( i );
+                }
+            }
+
+            function( 0 );
+
+            for ( auto worker : workers )
+            {
+                worker->waitFor();
+                delete worker;
+            }
+        }
+
+        inline unsigned clampThreads( size_t count, unsigned numThreads )
+        {
+            size_t maxThreads = count / minItemsPerThread;
+
+            if ( numThreads > maxThreads )
+                numThreads = static_cast<unsigned>( maxThreads );
+
+            return ( numThreads > 0 ) ? numThreads : 1;
+        }
+
+        inline size_t chunkBegin( size_t count, unsigned numChunks, unsigned chunk )
+        {
+            return static_cast<size_t>( static_cast<uint64_t>( count ) * chunk / numChunks );
+        }
+
+        // Merges sorted chunks pairwise until one run remains, splitting every level into
+        // `numThreads` equally sized pieces (merge path), so the last levels stay parallel too.
+        template <typename T, class Compare>
+        void mergeChunks( T* data, size_t count, unsigned numChunks, unsigned numThreads, T* buffer, Compare& less )
+        {
+            List<size_t> bounds;
+
+            for ( unsigned i = 0; i <= numChunks; i++ )
+                bounds.add( chunkBegin( count, numChunks, i ) );
+
+            T* src = data;
+            T* dst = buffer;
+
+            while ( bounds.getLength() > 2 )
+            {
+                runTasks( numThreads, [&] ( unsigned task )
+                {
+                    size_t outBegin = chunkBegin( count, numThreads, task );
+                    size_t outEnd = chunkBegin( count, numThreads, task + 1 );
+
+                    for ( size_t pair = 0; pair + 1 < bounds.getLength(); pair += 2 )
+                    {
+                        size_t begin = bounds[pair];
+                        size_t mid = bounds[pair + 1];
+                        size_t end = ( pair + 2 < bounds.getLength() ) ? bounds[pair + 2] : mid;
+
+                        if ( end <= outBegin || begin >= outEnd )
+                            continue;
+
+                        size_t k0 = ( outBegin > begin ) ? outBegin - begin : 0;
+                        size_t k1 = ( ( outEnd < end ) ? outEnd : end ) - begin;
+
+                        T* a = src + begin;
+                        T* b = src + mid;
+                        size_t na = mid - begin, nb = end - mid;
+
+                        size_t i0 = AlgorithmDetail::mergeSplit( a, na, b, nb, k0, less );
+                        size_t i1 = AlgorithmDetail::mergeSplit( a, na, b, nb, k1, less );
+
+                        AlgorithmDetail::merge( a + i0, a + i1, b + ( k0 - i0 ), b + ( k1 - i1 ), dst + begin + k0, less );
+                    }
+                } );
+
+                // Every other boundary disappears
+                List<size_t> merged;
+
+                for ( size_t i = 0; i < bounds.getLength(); i += 2 )
+                    merged.add( bounds[i] );
+
+                if ( merged[merged.getLength() - 1] != count )
+                    merged.add( count );
+
+                bounds = std::move( merged );
+                std::swap( src, dst );
+            }
+
+            if ( src != data )
+                runTasks( numThreads, [&] ( unsigned task )
+                {
+                    for ( size_t i = chunkBegin( count, numThreads, task ), end = chunkBegin( count, numThreads, task + 1 ); i < end; i++ )
+                        data[i] = std::move( src[i] );
+                } );
+        }
+
+        template <typename T, class Compare, class ChunkSort>
+        void sortAndMerge( T* data, size_t count, unsigned numThreads, T* buffer, Compare& less, ChunkSort chunkSort )
+        {
+            runTasks( numThreads, [&] ( unsigned chunk )
+            {
+                size_t begin = chunkBegin( count, numThreads, chunk );
+                chunkSort( data + begin, chunkBegin( count, numThreads, chunk + 1 ) - begin );
+            } );
+
+            T* ownBuffer = nullptr;
+
+            if ( buffer == nullptr )
+                buffer = ownBuffer = new T[count];
+
+            mergeChunks( data, count, numThreads, numThreads, buffer, less );
+
+            delete[] ownBuffer;
+        }
+    }
+
+    // Introsorts one chunk per thread, then merges the chunks in parallel. Needs a `count`-item buffer for the
+    // merge phase; one is allocated if not provided.
+    template <typename T, class Compare = Less>
+    void parallelSort( T* data, size_t count, unsigned numThreads, Compare less = Compare(), T* buffer = nullptr )
+    {
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return sort( data, count, less );
+
+        sortAndMerge( data, count, numThreads, buffer, less, [&] ( T* chunk, size_t n ) { sort( chunk, n, less ); } );
+    }
+
+    // Like parallelSort, but stable: the chunks are merge sorted and the merges prefer the left run on ties.
+    template <typename T, class Compare = Less>
+    void parallelStableSort( T* data, size_t count, unsigned numThreads, Compare less = Compare(), T* buffer = nullptr )
+    {
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return stableSort( data, count, less, buffer );
+
+        T* ownBuffer = nullptr;
+
+        if ( buffer == nullptr )
+            buffer = ownBuffer = new T[count];
+
+        // Each chunk borrows its own slice of the buffer, which is free again by the time the merges start
+        sortAndMerge( data, count, numThreads, buffer, less, [&] ( T* chunk, size_t n )
+        {
+            stableSort( chunk, n, less, buffer + ( chunk - data ) );
+        } );
+
+        delete[] ownBuffer;
+    }
+
+    // Parallel LSD radix sort. Every pass counts digits per chunk, derives each chunk's output offsets from
+    // the per-chunk counts (keeping the sort stable) and scatters all chunks concurrently.
+    template <typename T>
+    void parallelRadixSort( T* data, size_t count, unsigned numThreads, T* scratch = nullptr )
+    {
+        using namespace AlgorithmDetail;
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return radixSort( data, count, scratch );
+
+        typedef size_t Histograms[sizeof( T )][radixSize];
+
+        // Global digit counts, only needed to detect passes that can be skipped
+        Array<size_t> totalsStorage( numThreads * sizeof( Histograms ) / sizeof( size_t ) );
+        Histograms* chunkTotals = reinterpret_cast<Histograms*>( totalsStorage.getPtrUnsafe() );
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            size_t begin = chunkBegin( count, numThreads, chunk );
+            radixHistograms( data + begin, chunkBegin( count, numThreads, chunk + 1 ) - begin, chunkTotals[chunk] );
+        } );
+
+        T* ownScratch = nullptr;
+
+        if ( scratch == nullptr )
+            scratch = ownScratch = new T[count];
+
+        Array<size_t> offsets( static_cast<size_t>( numThreads ) * radixSize );
+        T* src = data;
+        T* dst = scratch;
+
+        for ( unsigned pass = 0; pass < sizeof( T ); pass++ )
+        {
+            size_t firstDigitTotal = 0;
+            unsigned firstDigit = radixDigit( data[0], pass );
+
+            for ( unsigned chunk = 0; chunk < numThreads; chunk++ )
+                firstDigitTotal += chunkTotals[chunk][pass][firstDigit];
+
+            if ( firstDigitTotal == count )
+                continue;
+
+            runTasks( numThreads, [&] ( unsigned chunk )
+            {
+                size_t* counts = offsets.getPtrUnsafe( chunk * radixSize );
+                memset( counts, 0, radixSize * sizeof( size_t ) );
+
+                for ( size_t i = chunkBegin( count, numThreads, chunk ), end = chunkBegin( count, numThreads, chunk + 1 ); i < end; i++ )
+                    counts[radixDigit( src[i], pass )]++;
+            } );
+
+            // Digit-major, chunk-minor prefix sum
+            size_t sum = 0;
+
+            for ( unsigned digit = 0; digit < radixSize; digit++ )
+                for ( unsigned chunk = 0; chunk < numThreads; chunk++ )
+                {
+                    size_t& offset = offsets.getUnsafe( chunk * radixSize + digit );
+                    size_t n = offset;
+                    offset = sum;
+                    sum += n;
+                }
+
+            runTasks( numThreads, [&] ( unsigned chunk )
+            {
+                size_t* next = offsets.getPtrUnsafe( chunk * radixSize );
+
+                for ( size_t i = chunkBegin( count, numThreads, chunk ), end = chunkBegin( count, numThreads, chunk + 1 ); i < end; i++ )
+                    dst[next[radixDigit( src[i], pass )]++] = src[i];
+            } );
+
+            std::swap( src, dst );
+        }
+
+        if ( src != data )
+            runTasks( numThreads, [&] ( unsigned chunk )
+            {
+                size_t begin = chunkBegin( count, numThreads, chunk );
+                memcpy( data + begin, src + begin, ( chunkBegin( count, numThreads, chunk + 1 ) - begin ) * sizeof( T ) );
+            } );
+
+        delete[] ownScratch;
+    }
+
+    // Partitions each chunk in place, then compacts the chunks into a scratch buffer and back.
+    // Returns the number of items satisfying `pred`. Not stable.
+    template <typename T, class Predicate>
+    size_t parallelPartition( T* data, size_t count, unsigned numThreads, Predicate pred )
+    {
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return partition( data, count, pred );
+
+        Array<size_t> numTrue( numThreads );
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            size_t begin = chunkBegin( count, numThreads, chunk );
+            numTrue.getUnsafe( chunk ) = partition( data + begin, chunkBegin( count, numThreads, chunk + 1 ) - begin, pred );
+        } );
+
+        size_t totalTrue = 0;
+
+        for ( unsigned chunk = 0; chunk < numThreads; chunk++ )
+            totalTrue += numTrue.getUnsafe( chunk );
+
+        T* scratch = new T[count];
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            size_t begin = chunkBegin( count, numThreads, chunk );
+            size_t end = chunkBegin( count, numThreads, chunk + 1 );
+            size_t trueOut = 0;
+
+            for ( unsigned i = 0; i < chunk; i++ )
+                trueOut += numTrue.getUnsafe( i );
+
+            size_t falseOut = totalTrue + ( begin - trueOut );
+
+            for ( size_t i = begin; i < begin + numTrue.getUnsafe( chunk ); i++ )
+                scratch[trueOut++] = std::move( data[i] );
+
+            for ( size_t i = begin + numTrue.getUnsafe( chunk ); i < end; i++ )
+                scratch[falseOut++] = std::move( data[i] );
+        } );
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            for ( size_t i = chunkBegin( count, numThreads, chunk ), end = chunkBegin( count, numThreads, chunk + 1 ); i < end; i++ )
+                data[i] = std::move( scratch[i] );
+        } );
+
+        delete[] scratch;
+        return totalTrue;
+    }
+
+    // Folds each chunk separately and combines the partial results in chunk order,
+    // so `op` must be associative (but needn't be commutative).
+    // Each chunk is seeded with its first element, so the accumulator is of the element type and `init` is converted to it
+    // (a plain 0 works for uint64_t items). An `init` wider than the items means accumulating in a wider type,
+    // which this form can't do without overflowing, so that is rejected; use the overload below instead.
+    template <typename T, typename Init, class Operation>
+    T parallelReduce( const T* data, size_t count, unsigned numThreads, Init initialValue, Operation op )
+    {
+        static_assert( std::is_convertible<Init, T>::value && ( std::is_same<Init, T>::value || sizeof( Init ) <= sizeof( T ) ),
+                "parallelReduce: to accumulate in another type, use the overload with identity and combine" );
+
+        typedef T Acc;
+        Acc init( std::move( initialValue ) );
+
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return reduce( data, count, std::move( init ), op );
+
+        Array<Acc> partial( numThreads );
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            size_t begin = chunkBegin( count, numThreads, chunk );
+            size_t end = chunkBegin( count, numThreads, chunk + 1 );
+
+            partial.getUnsafe( chunk ) = reduce( data + begin + 1, end - begin - 1, Acc( data[begin] ), op );
+        } );
+
+        for ( unsigned chunk = 0; chunk < numThreads; chunk++ )
+            init = op( std::move( init ), std::move( partial.getUnsafe( chunk ) ) );
+
+        return init;
+    }
+
+    // General form: every chunk is folded with `op( Acc, const T& )` starting from `identity`,
+    // then the partial results are folded into `init` with `combine( Acc, Acc )` in chunk order.
+    // Computes the same as reduce( data, count, init, op ) as long as `combine` is associative,
+    // `identity` is its identity, and `combine( a, op( b, x ) ) == op( combine( a, b ), x )`
+    // (e.g. counting: op = ( n, x ) -> n + 1, combine = plus, identity = 0).
+    template <typename T, typename Acc, class Operation, class Combine>
+    Acc parallelReduce( const T* data, size_t count, unsigned numThreads, Acc init, Operation op,
+            typename std::common_type<Acc>::type identity, Combine combine )
+    {
+        using namespace ParallelDetail;
+
+        numThreads = clampThreads( count, numThreads );
+
+        if ( numThreads == 1 )
+            return reduce( data, count, std::move( init ), op );
+
+        Array<Acc> partial( numThreads );
+
+        runTasks( numThreads, [&] ( unsigned chunk )
+        {
+            size_t begin = chunkBegin( count, numThreads, chunk );
+            size_t end = chunkBegin( count, numThreads, chunk + 1 );
+
+            partial.getUnsafe( chunk ) = reduce( data + begin, end - begin, identity, op );
+        } );
+
+        for ( unsigned chunk = 0; chunk < numThreads; chunk++ )
+            init = combine( std::move( init ), std::move( partial.getUnsafe( chunk ) ) );
+
+        return init;
+    }
+
+    // Container overloads, for List and anything else with getPtrUnsafe() and getLength().
+    // An Array has no length of its own; pass getPtrUnsafe() and the number of items in use to the pointer forms.
+
+    template <class Container, class Compare = Less>
+    auto parallelSort( Container& items, unsigned numThreads, Compare less = Compare() ) -> decltype( items.getLength(), void() )
+    {
+        parallelSort( items.getPtrUnsafe(), items.getLength(), numThreads, less );
+    }
+
+    template <class Container, class Compare = Less>
+    auto parallelStableSort( Container& items, unsigned numThreads, Compare less = Compare() ) -> decltype( items.getLength(), void() )
+    {
+        parallelStableSort( items.getPtrUnsafe(), items.getLength(), numThreads, less );
+    }
+
+    template <class Container>
+    auto parallelRadixSort( Container& items, unsigned numThreads ) -> decltype( items.getLength(), void() )
+    {
+        parallelRadixSort( items.getPtrUnsafe(), items.getLength(), numThreads );
+    }
+
+    template <class Container, class Predicate>
+    auto parallelPartition( Container& items, unsigned numThreads, Predicate pred ) -> decltype( items.getLength() )
+    {
+        return parallelPartition( items.getPtrUnsafe(), items.getLength(), numThreads, pred );
+    }
+
+    template <class Container, typename Init, class Operation>
+    auto parallelReduce( const Container& items, unsigned numThreads, Init init, Operation op )
+            -> decltype( items.getLength(), ParallelDetail::ItemType<Container>() )
+    {
+        return parallelReduce( items.getPtrUnsafe(), items.getLength(), numThreads, std::move( init ), op );
+    }
+
+    template <class Container, typename Acc, class Operation, class Combine>
+    auto parallelReduce( const Container& items, unsigned numThreads, Acc init, Operation op,
+            typename std::common_type<Acc>::type identity, Combine combine ) -> decltype( items.getLength(), Acc() )
+    {
+        return parallelReduce( items.getPtrUnsafe(), items.getLength(), numThreads, std::move( init ), op, std::move( identity ), combine );
+    }
+}
@@ -25,6 +25,8 @@
 
 #include <littl/Base.hpp>
 
+#include <cstdint>
+
 #ifdef li_MSW
 #ifndef NOMINMAX
 #define NOMINMAX
@@ -34,88 +36,172 @@
 #elif defined(__3DS__)
 #include <3ds.h>
 #else
-#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+#define li_PerfTiming_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
 namespace li
 {
+    // Nanoseconds since an arbitrary fixed point. Unaffected by changes to the wall clock and,
+    // unlike clock(), advancing while the process sleeps or blocks.
+    inline uint64_t getMonotonicNanos()
+    {
 #ifdef li_MSW
-    class PerfTimer
+        static const uint64_t freq = [] { LARGE_INTEGER freq; QueryPerformanceFrequency( &freq ); return static_cast<uint64_t>( freq.QuadPart ); }();
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter( &counter );
+
+        // Split to avoid overflowing after a few hours of uptime
+        uint64_t ticks = static_cast<uint64_t>( counter.QuadPart );
+        return ( ticks / freq ) * 1000000000ULL + ( ticks % freq ) * 1000000000ULL / freq;
+#elif defined(__3DS__)
+        return osGetTime() * 1000000ULL;
+#else
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+
+        return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+#endif
+    }
+
+#ifdef li_PerfTiming_TSC
+    // Reads the CPU's time-stamp counter, converted to nanoseconds with a factor calibrated against
+    // getMonotonicNanos(). An order of magnitude cheaper than a clock_gettime/QPC call, but only trustworthy
+    // on CPUs with an invariant TSC (constant rate, synchronized across cores) -- check isAvailable().
+    class TscClock
     {
-        public:
-            typedef uint64_t Counter;
+        uint64_t baseTicks, baseNanos;
+
+        // Nanoseconds per tick, 32.32 fixed point (>= 1.0 on counters slower than 1 GHz)
+        uint64_t scale;
+
+        // ( a * b ) >> 32 through a 128-bit intermediate
+        static uint64_t mulShift32( uint64_t a, uint64_t b )
+        {
+#if defined( __SIZEOF_INT128__ )
+            return static_cast<uint64_t>( ( static_cast<unsigned __int128>( a ) * b ) >> 32 );
+#elif defined( _M_X64 )
+            uint64_t high;
+            uint64_t low = _umul128( a, b, &high );
+            return ( high << 32 ) | ( low >> 32 );
+#else
+            uint64_t aLow = a & 0xFFFFFFFFULL, aHigh = a >> 32;
+            uint64_t bLow = b & 0xFFFFFFFFULL, bHigh = b >> 32;
 
-        private:
-            LARGE_INTEGER freq;
+            return ( ( aHigh * bHigh ) << 32 ) + aHigh * bLow + aLow * bHigh + ( ( aLow * bLow ) >> 32 );
+#endif
+        }
 
         public:
-            PerfTimer()
+            // Spins for `calibrationMillis` to measure the counter's rate
+            TscClock( unsigned calibrationMillis = 10 )
             {
-                QueryPerformanceFrequency( &freq );
-            }
+                uint64_t startNanos = getMonotonicNanos();
+                uint64_t startTicks = __rdtsc();
+                uint64_t nanos;
 
-            Counter getCurrentMicros()
-            {
-                LARGE_INTEGER counter;
-                QueryPerformanceCounter( &counter );
+                while ( ( nanos = getMonotonicNanos() ) - startNanos < calibrationMillis * 1000000ULL )
+                    ;
 
-                return counter.QuadPart * 1000000 / freq.QuadPart;
+                uint64_t ticks = __rdtsc() - startTicks;
+                nanos -= startNanos;
+
+                // In floating point, since `nanos << 32` would overflow for calibrations longer than ~4.3 s
+                scale = ( ticks > 0 ) ? static_cast<uint64_t>( static_cast<double>( nanos ) * 4294967296.0 / static_cast<double>( ticks ) ) : 0;
+                baseTicks = startTicks;
+                baseNanos = startNanos;
             }
 
-            Counter getCurrentMillis()
+            static bool isAvailable()
             {
-                LARGE_INTEGER counter;
-                QueryPerformanceCounter( &counter );
+                unsigned regs[4] = {};
 
-                return counter.QuadPart * 1000 / freq.QuadPart;
+#ifdef _MSC_VER
+                __cpuid( reinterpret_cast<int*>( regs ), 0x80000000 );
+
+                if ( regs[0] < 0x80000007 )
+                    return false;
+
+                __cpuid( reinterpret_cast<int*>( regs ), 0x80000007 );
+#else
+                if ( !__get_cpuid( 0x80000007, &regs[0], &regs[1], &regs[2], &regs[3] ) )
+                    return false;
+#endif
+
+                // Invariant TSC flag
+                return ( regs[3] & ( 1 << 8 ) ) != 0;
             }
 
-            static void tinySleepIfPossible()
+            uint64_t getCurrentNanos() const
             {
+                return baseNanos + mulShift32( __rdtsc() - baseTicks, scale );
             }
     };
-#else
+#endif
+
     class PerfTimer
     {
         public:
             typedef uint64_t Counter;
-        
-        public:
-            PerfTimer()
+
+        private:
+#ifdef li_PerfTiming_TSC
+            const TscClock* tsc;
+
+            static const TscClock& getTscClock()
             {
+                static const TscClock clock;
+                return clock;
             }
+#endif
 
-            Counter getCurrentMicros()
+        public:
+            // With `useTsc`, reads the time-stamp counter where it's invariant (calibrating it once per process)
+            PerfTimer( bool useTsc = false )
             {
-#ifndef __3DS__
-                struct timeval tv;
-                gettimeofday( &tv, nullptr );
+#ifdef li_PerfTiming_TSC
+                tsc = ( useTsc && TscClock::isAvailable() ) ? &getTscClock() : nullptr;
+#endif
+            }
 
-                return tv.tv_sec * 1000000 + tv.tv_usec;
-#else
-                return osGetTime() * 1000;
+            Counter getCurrentNanos()
+            {
+#ifdef li_PerfTiming_TSC
+                if ( tsc != nullptr )
+                    return tsc->getCurrentNanos();
 #endif
+
+                return getMonotonicNanos();
             }
 
-            Counter getCurrentMillis()
+            Counter getCurrentMicros()
             {
-#ifndef __3DS__
-                struct timeval tv;
-                gettimeofday( &tv, nullptr );
+                return getCurrentNanos() / 1000;
+            }
 
-                return tv.tv_sec * 1000 + tv.tv_usec / 1000;
-#else
-                return osGetTime();
-#endif
+            Counter getCurrentMillis()
+            {
+                return getCurrentNanos() / 1000000;
             }
 
             static void tinySleepIfPossible()
             {
+#if !defined(li_MSW) && !defined(__3DS__)
                 usleep( 1 );
+#endif
             }
     };
-#endif
 }
 
 /*
@@ -0,0 +1,441 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/Algorithm.hpp>
+#include <littl/Stream.hpp>
+
+#ifndef __li_MSW
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace li
+{
+    // File stream on a raw POSIX descriptor with its own (large) buffer. Compared to File (stdio):
+    //  - switching between reading and writing costs nothing unless there are buffered writes to push out
+    //  - getSize() is a single fstat
+    //  - readAt/writeAt use pread/pwrite, so several threads can read one file without seeking
+    //  - reads and writes larger than the buffer bypass it entirely
+    //
+    // With `directIO`, the page cache is bypassed (O_DIRECT, or F_NOCACHE on Apple). The stream keeps its own
+    // accesses aligned; readAt/writeAt then need block-aligned buffers, offsets and sizes from the caller.
+    class PosixFile : public IOStream
+    {
+        public:
+            enum
+            {
+                readOnly = 0,
+                readWrite = 1,
+                create = 2,
+                truncate = 4,
+                directIO = 8,
+
+                // Equivalent of File( fileName, true )
+                createNew = readWrite | create | truncate
+            };
+
+            enum Advice
+            {
+                adviseNormal,
+                adviseSequential,
+                adviseRandom,
+                adviseWillNeed,
+                adviseDontNeed
+            };
+
+            enum { defaultBufferSize = 1024 * 1024, directAlignment = 4096 };
+
+        private:
+            int fd;
+            int mode;
+
+            // Second descriptor on the same file without O_DIRECT, for writing unaligned tails (-1 if not needed)
+            int tailFd;
+            int lastError;
+
+            uint8_t* buffer;
+            size_t bufferSize;
+
+            // The buffer either caches file bytes [bufferPos, bufferPos + bufferFill) for reading,
+            // or (when dirty) holds bytes [bufferPos, bufferPos + bufferIndex) waiting to be written.
+            // Either way, the stream position is bufferPos + bufferIndex.
+            FilePos bufferPos;
+            size_t bufferFill, bufferIndex;
+            bool dirty, reachedEnd;
+
+            PosixFile( const PosixFile& );
+            PosixFile& operator = ( const PosixFile& );
+
+            PosixFile( int fd, int mode, int tailFd, uint8_t* buffer, size_t bufferSize )
+                    : fd( fd ), mode( mode ), tailFd( tailFd ), lastError( 0 ), buffer( buffer ), bufferSize( bufferSize ),
+                    bufferPos( 0 ), bufferFill( 0 ), bufferIndex( 0 ), dirty( false ), reachedEnd( false )
+            {
+            }
+
+            bool isDirect() const { return ( mode & directIO ) != 0; }
+
+            size_t readFully( void* out, size_t length, FilePos offset )
+            {
+                size_t done = 0;
+
+                while ( done < length )
+                {
+                    ssize_t count = pread( fd, reinterpret_cast<uint8_t*>( out ) + done, length - done, offset + done );
+
+                    if ( count < 0 && errno == EINTR )
+                        continue;
+
+                    if ( count < 0 )
+                        lastError = errno;
+
+                    if ( count <= 0 )
+                        break;
+
+                    done += count;
+                }
+
+                return done;
+            }
+
+            size_t writeFully( int target, const void* in, size_t length, FilePos offset )
+            {
+                size_t done = 0;
+
+                while ( done < length )
+                {
+                    ssize_t count = pwrite( target, reinterpret_cast<const uint8_t*>( in ) + done, length - done, offset + done );
+
+                    if ( count < 0 && errno == EINTR )
+                        continue;
+
+                    if ( count <= 0 )
+                    {
+                        lastError = errno;
+                        break;
+                    }
+
+                    done += count;
+                }
+
+                return done;
+            }
+
+            // Pushes out buffered writes; afterwards the buffer is empty and positioned at the stream position
+            bool flushBuffer()
+            {
+                bool success = true;
+
+                if ( dirty )
+                {
+                    // The tail of a direct-I/O stream usually isn't block-aligned. It goes through the other descriptor
+                    // rather than clearing O_DIRECT on `fd`, which would also affect concurrent readAt/writeAt calls.
+                    bool unaligned = tailFd != -1 && ( bufferPos % directAlignment != 0 || bufferIndex % directAlignment != 0 );
+
+                    success = writeFully( unaligned ? tailFd : fd, buffer, bufferIndex, bufferPos ) == bufferIndex;
+
+                    dirty = false;
+                }
+
+                bufferPos += bufferIndex;
+                bufferFill = 0;
+                bufferIndex = 0;
+                return success;
+            }
+
+            // Loads the buffer starting at (or, for direct I/O, just below) the stream position
+            bool fillBuffer()
+            {
+                FilePos pos = bufferPos + bufferIndex;
+                size_t skip = isDirect() ? static_cast<size_t>( pos % directAlignment ) : 0;
+
+                bufferPos = pos - skip;
+                bufferFill = readFully( buffer, bufferSize, bufferPos );
+                bufferIndex = ( skip < bufferFill ) ? skip : bufferFill;
+                return bufferIndex < bufferFill;
+            }
+
+        public:
+            using InputStream::read;
+            using OutputStream::write;
+
+            static PosixFile* open( const char* fileName, int mode = readOnly, size_t bufferSize = defaultBufferSize )
+            {
+                int flags = ( mode & readWrite ) ? O_RDWR : O_RDONLY;
+
+                if ( mode & create )
+                    flags |= O_CREAT;
+
+                if ( mode & truncate )
+                    flags |= O_TRUNC;
+
+#if defined( O_DIRECT )
+                if ( mode & directIO )
+                    flags |= O_DIRECT;
+#endif
+
+                int fd = ::open( fileName, flags, 0644 );
+
+                if ( fd == -1 )
+                    return nullptr;
+
+                int tailFd = -1;
+
+#if defined( O_DIRECT )
+                if ( ( mode & directIO ) && ( mode & readWrite ) )
+                {
+                    tailFd = ::open( fileName, flags & ~( O_DIRECT | O_CREAT | O_TRUNC ) );
+
+                    if ( tailFd == -1 )
+                    {
+                        ::close( fd );
+                        return nullptr;
+                    }
+                }
+#elif defined( F_NOCACHE )
+                // F_NOCACHE has no alignment requirements, so there is no need for a second descriptor
+                if ( mode & directIO )
+                    fcntl( fd, F_NOCACHE, 1 );
+#endif
+
+                if ( bufferSize < directAlignment )
+                    bufferSize = directAlignment;
+
+                bufferSize = align<directAlignment>( bufferSize );
+
+                // Aligned, so that the buffer can be handed to O_DIRECT reads and writes
+                void* buffer = nullptr;
+
+                if ( posix_memalign( &buffer, directAlignment, bufferSize ) != 0 )
+                {
+                    if ( tailFd != -1 )
+                        ::close( tailFd );
+
+                    ::close( fd );
+                    return nullptr;
+                }
+
+                return new PosixFile( fd, mode, tailFd, reinterpret_cast<uint8_t*>( buffer ), bufferSize );
+            }
+
+            virtual ~PosixFile()
+            {
+                flushBuffer();
+
+                if ( tailFd != -1 )
+                    ::close( tailFd );
+
+                ::close( fd );
+                free( buffer );
+            }
+
+            // Hints the expected access pattern for `length` bytes (0 = to the end) starting at `offset`
+            bool advise( Advice advice, FilePos offset = 0, FileSize length = 0 )
+            {
+#if defined( POSIX_FADV_NORMAL )
+                static const int flags[] = { POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED };
+
+                return posix_fadvise( fd, offset, length, flags[advice] ) == 0;
+#else
+                return advice == adviseNormal;
+#endif
+            }
+
+            int getFileDescriptor() const { return fd; }
+
+            // Positional reads and writes. They don't move the stream position and don't go through the buffer
+            // (so they can run concurrently from several threads), which also means readAt won't see buffered
+            // writes until flush() is called.
+            size_t readAt( void* out, size_t length, FilePos offset ) { return readFully( out, length, offset ); }
+            size_t writeAt( const void* in, size_t length, FilePos offset ) { return writeFully( fd, in, length, offset ); }
+
+            // Flushes the buffer and waits for the data to reach the disk
+            bool sync()
+            {
+                bool success = flushBuffer();
+#if defined( __linux__ )
+                return fdatasync( fd ) == 0 && success;
+#else
+                return fsync( fd ) == 0 && success;
+#endif
+            }
+
+            // *** Stream methods ***
+
+            virtual bool finite() override { return true; }
+            virtual bool seekable() override { return true; }
+
+            virtual void flush() override
+            {
+                if ( dirty )
+                    flushBuffer();
+            }
+
+            virtual const char* getErrorDesc() override
+            {
+                return lastError != 0 ? strerror( lastError ) : nullptr;
+            }
+
+            virtual FilePos getPos() override
+            {
+                return bufferPos + bufferIndex;
+            }
+
+            virtual FileSize getSize() override
+            {
+                struct stat st;
+
+                if ( fstat( fd, &st ) != 0 )
+                {
+                    lastError = errno;
+                    return 0;
+                }
+
+                FileSize size = st.st_size;
+
+                // Buffered writes may extend the file
+                if ( dirty && bufferPos + bufferIndex > size )
+                    size = bufferPos + bufferIndex;
+
+                return size;
+            }
+
+            virtual bool setPos( FilePos pos ) override
+            {
+                reachedEnd = false;
+
+                // Seeking within the read buffer is free
+                if ( !dirty && pos >= bufferPos && pos <= bufferPos + bufferFill )
+                {
+                    bufferIndex = static_cast<size_t>( pos - bufferPos );
+                    return true;
+                }
+
+                bool success = flushBuffer();
+                bufferPos = pos;
+                return success;
+            }
+
+            // *** InputStream methods ***
+
+            virtual bool eof() override
+            {
+                return reachedEnd;
+            }
+
+            virtual size_t read( void* out, size_t length ) override
+            {
+                if ( dirty && !flushBuffer() )
+                    return 0;
+
+                uint8_t* output = reinterpret_cast<uint8_t*>( out );
+                size_t done = 0;
+
+                while ( done < length )
+                {
+                    size_t available = bufferFill - bufferIndex;
+
+                    if ( available > 0 )
+                    {
+                        size_t count = ( length - done < available ) ? length - done : available;
+                        memcpy( output + done, buffer + bufferIndex, count );
+                        bufferIndex += count;
+                        done += count;
+                        continue;
+                    }
+
+                    // Large reads go straight to the destination
+                    if ( !isDirect() && length - done >= bufferSize )
+                    {
+                        FilePos pos = bufferPos + bufferIndex;
+                        size_t count = readFully( output + done, length - done, pos );
+
+                        bufferPos = pos + count;
+                        bufferFill = 0;
+                        bufferIndex = 0;
+                        done += count;
+
+                        if ( done < length )
+                            reachedEnd = true;
+
+                        break;
+                    }
+
+                    if ( !fillBuffer() )
+                    {
+                        reachedEnd = true;
+                        break;
+                    }
+                }
+
+                return done;
+            }
+
+            // *** OutputStream methods ***
+
+            virtual size_t write( const void* in, size_t length ) override
+            {
+                const uint8_t* input = reinterpret_cast<const uint8_t*>( in );
+
+                if ( !dirty )
+                {
+                    // Drop the read-ahead; the position stays where the reader left it
+                    bufferPos += bufferIndex;
+                    bufferFill = 0;
+                    bufferIndex = 0;
+
+                    // Large writes go straight to the file
+                    if ( !isDirect() && length >= bufferSize )
+                    {
+                        size_t count = writeFully( fd, input, length, bufferPos );
+                        bufferPos += count;
+                        return count;
+                    }
+                }
+
+                size_t done = 0;
+
+                while ( done < length )
+                {
+                    if ( bufferIndex == bufferSize && !flushBuffer() )
+                        break;
+
+                    size_t space = bufferSize - bufferIndex;
+                    size_t count = ( length - done < space ) ? length - done : space;
+
+                    memcpy( buffer + bufferIndex, input + done, count );
+                    bufferIndex += count;
+                    done += count;
+                    dirty = true;
+                }
+
+                return done;
+            }
+    };
+}
+#endif
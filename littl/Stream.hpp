@@ -24,6 +24,7 @@
 #pragma once
 
 #include <littl/Base.hpp>
+#include <littl/PerfTiming.hpp>
 #include <littl/String.hpp>
 
 #include <ctime>
@@ -57,19 +58,17 @@ namespace li
 #endif
     }
 
+    // Milliseconds on the monotonic clock; wraps around every ~49 days, so only compare differences
     inline unsigned relativeTime()
     {
-#ifdef li_MSW
-        return GetTickCount();
-#else
-        return clock() * 1000 / CLOCKS_PER_SEC;
-#endif
+        return static_cast<unsigned>( getMonotonicNanos() / 1000000 );
     }
 
     struct Timeout
     {
         bool infinite;
-        unsigned millis, endTime;
+        unsigned millis;
+        uint64_t deadline;
 
         Timeout() : infinite( true )
         {
@@ -80,18 +79,24 @@ namespace li
             reset();
         }
 
+        // Milliseconds left (rounded up, so it only reaches 0 once the deadline has passed), or -1 if infinite
         int getRemaining() const
         {
             if ( infinite )
                 return -1;
-            else
-                return millis > 0 ? int( endTime - relativeTime() ) : 0;
+
+            uint64_t now = getMonotonicNanos();
+
+            if ( millis == 0 || now >= deadline )
+                return 0;
+
+            return int( ( deadline - now + 999999 ) / 1000000 );
         }
 
         void reset()
         {
-            if ( !infinite && millis > 0 )
-                endTime = relativeTime() + millis;
+            if ( !infinite )
+                deadline = getMonotonicNanos() + millis * 1000000ULL;
         }
 
         bool timedOut() const
@@ -379,7 +384,7 @@ namespace li
             template <typename T> void fastWriteItem( const T item )
             {
                 size += sizeof( T );
-                resize( size, true );
+                grow( size );
 
                 *reinterpret_cast<T*>( getPtrUnsafe( index ) ) = item;
                 index += sizeof( T );
@@ -395,7 +400,7 @@ namespace li
 
             void growBuffer( size_t amount )
             {
-                resize( size + amount, true );
+                grow( size + amount );
             }
 
             virtual size_t read( void* out, size_t length ) override
@@ -421,6 +426,11 @@ namespace li
                 return obj;
             }
 
+            void shrinkToFit()
+            {
+                resize( size );
+            }
+
             void setSize( size_t size )
             {
                 this->size = size;
@@ -431,7 +441,7 @@ namespace li
                 if ( index + length > size )
                 {
                     size = index + length;
-                    resize( size, true );
+                    grow( size );
                 }
 
                 memcpy( getPtrUnsafe( index ), input, length );
@@ -444,7 +454,7 @@ namespace li
                 if ( index + length > size )
                 {
                     size = index + length;
-                    resize( size, true );
+                    grow( size );
                 }
 
                 void* ret = getPtrUnsafe( index );
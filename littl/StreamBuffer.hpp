@@ -58,7 +58,7 @@ namespace li
 
             template <typename T2> T2 read()
             {
-                Array<T>::resize( pos + sizeof( T2 ), true );
+                Array<T>::grow( pos + sizeof( T2 ) );
 
                 T2 temp = *( T2* )( Array<T>::getPtr( pos ) );
                 seek( sizeof( T2 ) );
@@ -96,7 +96,7 @@ namespace li
 
             template <typename T2> void write( T2 item )
             {
-                Array<T>::resize( pos + sizeof( T2 ), true );
+                Array<T>::grow( pos + sizeof( T2 ) );
 
                 *( T2* )( Array<T>::getPtr( pos ) ) = item;
                 seek( sizeof( T2 ) );
@@ -106,7 +106,7 @@ namespace li
             {
                 if ( !string.isEmpty() )
                 {
-                    Array<T>::resize( pos + string.getNumBytes() + 1, true );
+                    Array<T>::grow( pos + string.getNumBytes() + 1 );
 
                     memcpy( Array<T>::getPtr( pos ), string, string.getNumBytes() + 1 );
                     seek( string.getNumBytes() + 1 );
@@ -123,7 +123,7 @@ namespace li
 
             void shiftRight( unsigned count )
             {
-                Array<T>::resize( length + count, true );
+                Array<T>::grow( length + count );
                 Array<T>::move( count, 0, length );
                 length += count;
             }
@@ -22,20 +22,25 @@
 
 #pragma once
 
+#include <littl/Hash.hpp>
 #include <littl/List.hpp>
 #include <littl/StringCaseCompare.hpp>
+#include <littl/StringView.hpp>
 #include <littl/Utf8.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <new>
 
 namespace li
 {
-#define default_init_seq data( 0 ), numBytes( 0 ), capacity( 0 ), numChars( 0 )
+#define default_init_seq numBytes( 0 ), numChars( 0 ), local()
 
     template <int blockSize = 0x10> class StringTpl
     {
@@ -43,21 +48,117 @@ namespace li
             enum Base { undefined, decimal, hexadecimal };
 
         protected:
-            char* data;
-            size_t numBytes, capacity;
+            // Strings of up to localCapacity bytes (including the terminator) are stored inline, in the space
+            // of the heap pointer and capacity, so that a String is no larger than before (4 words).
+            // The active buffer is selected by a flag in the last byte rather than a self-pointer,
+            // so that containers may keep relocating StringTpl instances with memcpy/realloc.
+            static constexpr size_t localCapacity = 2 * sizeof( size_t ) - 1;
+
+            // Strings of at least minBytesForBreadcrumbs get a lazily built table holding the number of characters,
+            // followed by the byte offset of every breadcrumbInterval-th character (omitted for ASCII strings),
+            // so that character indices resolve in O(breadcrumbInterval).
+            enum { breadcrumbInterval = 64, minBytesForBreadcrumbs = 256 };
+
+            size_t numBytes;
+
+            // -1 if unknown; only cached by the non-const getNumChars(), const methods never write it
             intptr_t numChars;
 
-        public:
-            StringTpl() : default_init_seq
+            // Caches filled in by const methods, possibly on several threads at once. They live in front of the heap buffer,
+            // so the inline part of a string stays plain data, and local strings (which are cheap to hash) don't carry them.
+            struct HeapHeader
+            {
+                // 0 until getHash() is called; reset whenever the buffer is handed out for writing.
+                // Every thread stores the same value, so relaxed ordering is enough.
+                std::atomic<size_t> cachedHash;
+
+                // Built by getBreadcrumbs() const, so it is published with a compare-exchange; see there
+                std::atomic<size_t*> breadcrumbs;
+
+                HeapHeader() : cachedHash( 0 ), breadcrumbs( nullptr ) {}
+            };
+
+            union
+            {
+                struct
+                {
+                    char* data;
+                    size_t capacity;
+                }
+                heap;
+
+                char local[localCapacity + 1];
+            };
+
+            bool hasHeapBuffer() const { return !isLocal() && heap.data != nullptr; }
+            HeapHeader* getHeapHeader() const { return reinterpret_cast<HeapHeader*>( heap.data ) - 1; }
+
+            void invalidateCaches()
             {
+                if ( !hasHeapBuffer() )
+                    return;
+
+                HeapHeader* header = getHeapHeader();
+                header->cachedHash.store( 0, std::memory_order_relaxed );
+
+                size_t* crumbs = header->breadcrumbs.load( std::memory_order_relaxed );
+
+                if ( crumbs != nullptr )
+                {
+                    free( crumbs );
+                    header->breadcrumbs.store( nullptr, std::memory_order_relaxed );
+                }
             }
 
-            StringTpl( StringTpl&& other ) : data( other.data ), numBytes( other.numBytes ), capacity( other.capacity ), numChars( other.numChars )
+            // Frees the heap buffer (if any) together with its caches; leaves heap.data dangling
+            void releaseHeapBuffer()
             {
-                other.data = nullptr;
+                if ( !hasHeapBuffer() )
+                    return;
+
+                invalidateCaches();
+
+                HeapHeader* header = getHeapHeader();
+                header->~HeapHeader();
+                free( header );
+            }
+
+            const size_t* getBreadcrumbs() const;
+            size_t getByteOffset( size_t charIndex ) const;
+            size_t getCharIndex( size_t byteOffset ) const;
+
+            bool isLocal() const { return local[localCapacity] != 0; }
+            void setLocal( bool isLocal ) { local[localCapacity] = isLocal ? 1 : 0; }
+
+            // Grows geometrically, so that a sequence of appends reallocates O(log n) times
+            void grow( size_t minCapacity )
+            {
+                const size_t currentCapacity = getCapacity();
+
+                if ( minCapacity > currentCapacity )
+                    setBuffer( std::max( minCapacity, currentCapacity + currentCapacity / 2 ) );
+            }
+
+            void moveStorageFrom( StringTpl& other )
+            {
+                numBytes = other.numBytes;
+                numChars = other.numChars;
+                memcpy( local, other.local, sizeof( local ) );
+
                 other.numBytes = 0;
-                other.capacity = 0;
                 other.numChars = 0;
+                other.heap.data = nullptr;
+                other.setLocal( false );
+            }
+
+        public:
+            StringTpl() : default_init_seq
+            {
+            }
+
+            StringTpl( StringTpl&& other )
+            {
+                moveStorageFrom( other );
             }
 
             StringTpl( const char* stringUtf8 ) : default_init_seq
@@ -85,6 +186,12 @@ namespace li
                 set( other );
             }
 
+            // Copies the viewed bytes
+            explicit StringTpl( const StringView& view ) : default_init_seq
+            {
+                set( view.getData(), view.getNumBytes() );
+            }
+
             StringTpl( const StringTpl* other ) : default_init_seq
             {
                 set( *other );
@@ -137,12 +244,11 @@ namespace li
 
             void clear()
             {
-                if ( data )
-                    free( data );
-
+                releaseHeapBuffer();
                 numChars = 0;
-                numBytes = capacity = 0;
-                data = 0;
+                numBytes = 0;
+                heap.data = nullptr;
+                setLocal( false );
             }
 
             static int compare( const char* s1, const char* s2, bool caseSensitive = true )
@@ -161,12 +267,12 @@ namespace li
 
             const char* c_str() const
             {
-                return ( data != nullptr ) ? data : "";
+                return ( getBuffer() != nullptr ) ? getBuffer() : "";
             }
 
             void debug() const
             {
-                printf( "'%s' [%i, %i, %i]\n", data, numChars, numBytes, capacity );
+                printf( "'%s' [%i, %i, %i%s]\n", c_str(), ( int ) numChars, ( int ) numBytes, ( int ) getCapacity(), isLocal() ? ", local" : "" );
             }
 
             StringTpl<blockSize> dropLeftPart( size_t length ) const;
@@ -194,13 +300,34 @@ namespace li
             static StringTpl<blockSize> formatBool( bool value, bool useText = false );
             static StringTpl<blockSize> formatFloat( float value, int width = -1 );
             static StringTpl<blockSize> formatInt( int value, int width = -1, Base base = decimal );
-            char* getBuffer() { return data; }
+            char* getBuffer() { invalidateCaches(); return isLocal() ? local : heap.data; }
+            const char* getBuffer() const { return isLocal() ? local : heap.data; }
+            size_t getCapacity() const { return isLocal() ? localCapacity : ( heap.data ? heap.capacity : 0 ); }
             Unicode::Char getChar( size_t& index ) const;
             StringTpl<blockSize> getFiltered( int (* filter)( int c ) ) const;
+            StringTpl<blockSize> getSlice( size_t beginByte, size_t endByte, intptr_t numChars = -1 ) const;
+            StringView getView() const { return StringView( c_str(), numBytes, numChars ); }
+
+            static size_t getHash( const char* string ) { return getHash( string, string ? strlen( string ) : 0 ); }
+            static size_t getHash( const char* string, size_t numBytes );
+            static size_t getHash( const StringTpl& string ) { return string.getHash(); }
+
+            size_t getHash() const
+            {
+                if ( !hasHeapBuffer() )
+                    return getHash( getBuffer(), numBytes );
 
-            static size_t getHash( const char* string );
-            static size_t getHash( const StringTpl& string ) { return getHash( string.c_str() ); }
-            size_t getHash() const { return getHash( *this ); }
+                std::atomic<size_t>& cachedHash = getHeapHeader()->cachedHash;
+                size_t hash = cachedHash.load( std::memory_order_relaxed );
+
+                if ( hash == 0 )
+                {
+                    hash = getHash( getBuffer(), numBytes );
+                    cachedHash.store( hash, std::memory_order_relaxed );
+                }
+
+                return hash;
+            }
 
             size_t getNumBytes() const
             {
@@ -215,6 +342,22 @@ namespace li
                 return numChars;
             }
 
+            size_t getNumChars() const
+            {
+                if ( numChars >= 0 )
+                    return numChars;
+
+                if ( numBytes >= minBytesForBreadcrumbs )
+                {
+                    const size_t* crumbs = getBreadcrumbs();
+
+                    if ( crumbs != nullptr )
+                        return crumbs[0];
+                }
+
+                return getNumCharsUncached();
+            }
+
             size_t getNumCharsCached( intptr_t& cache ) const
             {
                 if ( cache < 0 )
@@ -226,19 +369,21 @@ namespace li
             size_t getNumCharsUncached() const
             {
                 if ( numChars < 0 )
-                    return Utf8::numChars( data );
+                    return Utf8::numChars( getBuffer(), numBytes );
                 else
                     return numChars;
             }
 
             bool isEmpty() const
             {
-                return data == 0 || Utf8::isEmpty( data );
+                return numBytes == 0;
             }
 
             StringTpl<blockSize> leftPart( size_t length ) const;
+            void reserve( size_t minCapacity ) { if ( minCapacity > getCapacity() ) setBuffer( minCapacity ); }
             StringTpl<blockSize> left( size_t length ) const { return leftPart( length ); }
             unsigned parse( List<StringTpl>& tokens, Unicode::Char separator, Unicode::Char escape = Unicode::invalidChar, bool strict = false ) const;
+            unsigned parse( List<StringView>& tokens, Unicode::Char separator, bool strict = false ) const { return getView().parse( tokens, separator, strict ); }
             StringTpl<blockSize> replaceAll( const StringTpl& pattern, const StringTpl& replaceWith ) const;
             StringTpl<blockSize> rightPart( size_t length ) const;
             StringTpl<blockSize> right( size_t length ) const { return rightPart( length ); };
@@ -246,13 +391,16 @@ namespace li
             void set( const char* stringUtf8, size_t numBytes );
             void set( const StringTpl& other );
             void setBuffer( size_t requestedCapacity );
+            void shrinkToFit() { setBuffer( ( numBytes == 0 ) ? 0 : ( numBytes + 1 ) ); }
             void split( Unicode::Char separator, StringTpl& left, StringTpl& right, bool rightDefault = false );
             void split( const StringTpl& separator, StringTpl& left, StringTpl& right, bool rightDefault = false );
+            void split( Unicode::Char separator, StringView& left, StringView& right, bool rightDefault = false ) const { getView().split( separator, left, right, rightDefault ); }
+            void split( const StringView& separator, StringView& left, StringView& right, bool rightDefault = false ) const { getView().split( separator, left, right, rightDefault ); }
             StringTpl<blockSize> subString( size_t begin, size_t length ) const;
 
             int toAscii( Array<char>& output );
 
-            bool toBool() const { return toBool( data ); }
+            bool toBool() const { return toBool( getBuffer() ); }
             static bool toBool( const char* text )
             {
                 if ( text == nullptr )
@@ -264,36 +412,30 @@ namespace li
                 return strtol( text, nullptr, 0 ) != 0;
             }
 
-            double toDouble() const { return toDouble( data ); }
+            double toDouble() const { return toDouble( getBuffer() ); }
             static double toDouble( const char* text ) { return text != nullptr ? strtod( text, nullptr ) : 0; }
 
-            float toFloat() const { return toFloat( data ); }
+            float toFloat() const { return toFloat( getBuffer() ); }
             static float toFloat( const char* text ) { return text != nullptr ? strtof( text, nullptr ) : 0; }
 
-            long toInt() const { return toInt( data ); }
+            long toInt() const { return toInt( getBuffer() ); }
             static long toInt( const char* text ) { return text != nullptr ? strtol( text, nullptr, 0 ) : 0; }
 
-            uint64_t toUnsigned( Base base = undefined ) const { return parseUnsigned( data, base ); }
+            uint64_t toUnsigned( Base base = undefined ) const { return parseUnsigned( getBuffer(), base ); }
             static uint64_t parseUnsigned( const char* text, Base base = undefined );
 
             operator const char* () const
             {
-                return data;
+                return getBuffer();
             }
 
             StringTpl& operator = ( StringTpl&& other )
             {
-                clear();
-
-                data = other.data;
-                numBytes = other.numBytes;
-                capacity = other.capacity;
-                numChars = other.numChars;
-
-                other.data = nullptr;
-                other.numBytes = 0;
-                other.capacity = 0;
-                other.numChars = 0;
+                if ( this != &other )
+                {
+                    clear();
+                    moveStorageFrom( other );
+                }
 
                 return *this;
             }
@@ -322,10 +464,12 @@ namespace li
 #define operator_append_num( type, fmt )\
             void appendNumber( type num )\
             {\
-                char buffer[20];\
+                char buffer[32];\
+\
+                int length = snprintf( buffer, sizeof( buffer ), fmt, static_cast<type>( num ) );\
 \
-                snprintf( buffer, 20, fmt, static_cast<type>( num ) );\
-                append( buffer );\
+                if ( length > 0 )\
+                    append( buffer, std::min<size_t>( length, sizeof( buffer ) - 1 ) );\
             }\
 \
             StringTpl& operator += ( type other )\
@@ -375,13 +519,13 @@ namespace li
 #define operator_to_int( type )\
             operator type () const\
             {\
-                return data ? strtol( data, 0, 0 ) : 0;\
+                return getBuffer() ? strtol( getBuffer(), 0, 0 ) : 0;\
             }
 
 #define operator_to_num( type )\
             operator type () const\
             {\
-                return ( type )( data ? strtod( data, 0 ) : 0.0 );\
+                return ( type )( getBuffer() ? strtod( getBuffer(), 0 ) : 0.0 );\
             }
 
             operator_set( const char* )
@@ -406,6 +550,9 @@ namespace li
             operator_compare( const char* )
             operator_compare( const StringTpl& )
 
+            bool operator == ( const StringView& other ) const { return other.equals( *this ); }
+            bool operator != ( const StringView& other ) const { return !other.equals( *this ); }
+
             /*operator_to_int( short )
             operator_to_int( int )
             operator_to_int( unsigned )
@@ -428,8 +575,8 @@ namespace li
         if ( numChars >= 0 )
             numChars++;
 
-        setBuffer( numBytes + 2 );
-        strncpy( data + numBytes, buffer, 2 );
+        grow( numBytes + 2 );
+        strncpy( getBuffer() + numBytes, buffer, 2 );
 
         numBytes++;
     }
@@ -447,8 +594,8 @@ namespace li
             if ( numChars >= 0 )
                 numChars++;
 
-            setBuffer( numBytes + numBytesInc + 1 );
-            strncpy( data + numBytes, buffer, numBytesInc + 1 );
+            grow( numBytes + numBytesInc + 1 );
+            strncpy( getBuffer() + numBytes, buffer, numBytesInc + 1 );
 
             numBytes += numBytesInc;
         }
@@ -467,8 +614,8 @@ namespace li
         numChars = -1;
         size_t numBytesInc = strlen( stringUtf8 );
 
-        setBuffer( numBytes + numBytesInc + 1 );
-        memcpy( data + numBytes, stringUtf8, numBytesInc + 1 );
+        grow( numBytes + numBytesInc + 1 );
+        memcpy( getBuffer() + numBytes, stringUtf8, numBytesInc + 1 );
 
         numBytes += numBytesInc;
     }
@@ -480,11 +627,11 @@ namespace li
 
         numChars = -1;
 
-        setBuffer( this->numBytes + numBytes );
-        memcpy( data + this->numBytes, stringUtf8, numBytes );
+        grow( this->numBytes + numBytes + 1 );
+        memcpy( getBuffer() + this->numBytes, stringUtf8, numBytes );
         
         this->numBytes += numBytes;
-        data[this->numBytes] = 0;
+        getBuffer()[this->numBytes] = 0;
     }
 
     __li_member( void ) append( const StringTpl& other )
@@ -497,8 +644,8 @@ namespace li
         else
             numChars = -1;
 
-        setBuffer( numBytes + other.numBytes + 1 );
-        strncpy( data + numBytes, other.data, other.numBytes + 1 );
+        grow( numBytes + other.numBytes + 1 );
+        strncpy( getBuffer() + numBytes, other.getBuffer(), other.numBytes + 1 );
 
         numBytes += other.numBytes;
     }
@@ -531,37 +678,33 @@ namespace li
 
     __li_member( Unicode::Char ) charAt( size_t offset ) const
     {
-        size_t index = 0;
-
-        for ( size_t i = 0; i < offset; i++ )
-            if ( getChar( index ) == Unicode::invalidChar )
-                return Unicode::invalidChar;
+        size_t index = getByteOffset( offset );
 
         return getChar( index );
     }
 
     __li_member( StringTpl<blockSize> ) dropLeftPart( size_t length ) const
     {
-        intptr_t cache = -1;
+        const size_t count = getNumChars();
 
-        if ( length >= getNumCharsCached( cache ) )
+        if ( length >= count )
             return StringTpl();
         else if ( length == 0 )
             return this;
         else
-            return rightPart( getNumCharsCached( cache ) - length );
+            return getSlice( getByteOffset( length ), numBytes, count - length );
     }
 
     __li_member( StringTpl<blockSize> ) dropRightPart( size_t length ) const
     {
-        intptr_t cache = -1;
+        const size_t count = getNumChars();
 
-        if ( length >= getNumCharsCached( cache ) )
+        if ( length >= count )
             return StringTpl();
         else if ( length == 0 )
             return this;
         else
-            return leftPart( getNumCharsCached( cache ) - length );
+            return getSlice( 0, getByteOffset( count - length ), count - length );
     }
 
     __li_member( bool ) endsWith( UnicodeChar c )
@@ -604,17 +747,12 @@ namespace li
 
     __li_member( intptr_t ) findChar( Unicode::Char c, size_t beginAt ) const
     {
-        size_t index = 0;
-
-        for ( size_t i = 0; i < beginAt; i++ )
-            if ( getChar( index ) == Unicode::invalidChar )
-                return -1;
-
-        for ( size_t charIndex = beginAt; index < getNumBytes(); charIndex++ )
-            if ( getChar( index ) == c )
-                return charIndex;
+        char encoded[7];
+        const size_t length = Utf8::encode( c, encoded );
+        const size_t offset = getByteOffset( beginAt );
+        const intptr_t pos = StringView::findBytes( c_str() + offset, numBytes - offset, encoded, length );
 
-        return -1;
+        return ( pos >= 0 ) ? getCharIndex( offset + pos ) : -1;
     }
 
     __li_member( intptr_t ) findDifferentChar( Unicode::Char c, size_t beginAt ) const
@@ -676,37 +814,10 @@ namespace li
 
     __li_member( intptr_t ) findSubString( const StringTpl& pattern, size_t beginAt ) const
     {
-        size_t index = 0;
-
-        for ( size_t i = 0; i < beginAt; i++ )
-            if ( getChar( index ) == Unicode::invalidChar )
-                return -1;
-
-        for ( size_t charIndex = beginAt; index < getNumBytes(); charIndex++ )
-        {
-            size_t otherSubIndex = 0;
+        const size_t offset = getByteOffset( beginAt );
+        const intptr_t pos = StringView::findBytes( c_str() + offset, numBytes - offset, pattern.c_str(), pattern.numBytes );
 
-            const Unicode::Char thisChar = getChar( index ),
-                    otherChar = pattern.getChar( otherSubIndex );
-
-            if ( thisChar == otherChar )
-            {
-                size_t subIndex = index;
-
-                while ( subIndex <= getNumBytes() )
-                {
-                    const Unicode::Char thisSubChar = getChar( subIndex ),
-                            otherSubChar = pattern.getChar( otherSubIndex );
-
-                    if ( otherSubChar == Unicode::invalidChar )
-                        return charIndex;
-                    else if ( thisSubChar != otherSubChar )
-                        break;
-                }
-            }
-        }
-
-        return -1;
+        return ( pos >= 0 ) ? getCharIndex( offset + pos ) : -1;
     }
 
     __li_member( StringTpl<blockSize> ) formatBool( bool value, bool useText )
@@ -723,7 +834,7 @@ namespace li
         StringTpl numBuffer;
 
         numBuffer.setBuffer( std::max( width, 30 ) );
-        snprintf( numBuffer.data, numBuffer.capacity, format, value );
+        snprintf( numBuffer.getBuffer(), numBuffer.getCapacity(), format, value );
 
         return numBuffer.c_str();
     }
@@ -734,11 +845,120 @@ namespace li
         StringTpl numBuffer;
 
         numBuffer.setBuffer( std::max( width, 30 ) );
-        snprintf( numBuffer.data, numBuffer.capacity, format, value );
+        snprintf( numBuffer.getBuffer(), numBuffer.getCapacity(), format, value );
 
         return numBuffer.c_str();
     }
 
+    __li_member( const size_t* ) getBreadcrumbs() const
+    {
+        // Only long strings get here, and those are never local
+        if ( !hasHeapBuffer() )
+            return nullptr;
+
+        std::atomic<size_t*>& breadcrumbs = getHeapHeader()->breadcrumbs;
+        size_t* crumbs = breadcrumbs.load( std::memory_order_acquire );
+
+        if ( crumbs != nullptr )
+            return crumbs;
+
+        const size_t count = getNumCharsUncached();
+        const size_t numCrumbs = ( count == numBytes ) ? 0 : ( count / breadcrumbInterval + 1 );
+
+        crumbs = reinterpret_cast<size_t*>( malloc( ( 1 + numCrumbs ) * sizeof( size_t ) ) );
+
+        if ( crumbs == nullptr )
+            return nullptr;
+
+        crumbs[0] = count;
+
+        const char* data = getBuffer();
+
+        for ( size_t i = 0, charIndex = 0; numCrumbs > 0 && i < numBytes; i++ )
+        {
+            if ( ( data[i] & 0xC0 ) != 0x80 )
+            {
+                if ( charIndex % breadcrumbInterval == 0 )
+                    crumbs[1 + charIndex / breadcrumbInterval] = i;
+
+                charIndex++;
+            }
+        }
+
+        // Const readers may race to build the table; the first one to finish publishes it, the others free their copy
+        size_t* published = nullptr;
+
+        if ( !breadcrumbs.compare_exchange_strong( published, crumbs, std::memory_order_acq_rel, std::memory_order_acquire ) )
+        {
+            free( crumbs );
+            return published;
+        }
+
+        return crumbs;
+    }
+
+    __li_member( size_t ) getByteOffset( size_t charIndex ) const
+    {
+        if ( charIndex == 0 )
+            return 0;
+
+        if ( numChars >= 0 )
+        {
+            if ( charIndex >= static_cast<size_t>( numChars ) )
+                return numBytes;
+            else if ( static_cast<size_t>( numChars ) == numBytes )
+                return charIndex;
+        }
+
+        const char* data = getBuffer();
+        size_t start = 0;
+
+        if ( numBytes >= minBytesForBreadcrumbs )
+        {
+            const size_t* crumbs = getBreadcrumbs();
+
+            if ( crumbs != nullptr )
+            {
+                if ( charIndex >= crumbs[0] )
+                    return numBytes;
+                else if ( crumbs[0] == numBytes )
+                    return charIndex;
+
+                start = crumbs[1 + charIndex / breadcrumbInterval];
+                charIndex %= breadcrumbInterval;
+            }
+        }
+
+        return start + StringView( data + start, numBytes - start ).getByteOffset( charIndex );
+    }
+
+    __li_member( size_t ) getCharIndex( size_t byteOffset ) const
+    {
+        if ( numChars >= 0 && static_cast<size_t>( numChars ) == numBytes )
+            return byteOffset;
+
+        const char* data = getBuffer();
+
+        if ( numBytes >= minBytesForBreadcrumbs )
+        {
+            const size_t* crumbs = getBreadcrumbs();
+
+            if ( crumbs != nullptr )
+            {
+                if ( crumbs[0] == numBytes )
+                    return byteOffset;
+
+                const size_t* offsets = crumbs + 1;
+                const size_t numCrumbs = crumbs[0] / breadcrumbInterval + 1;
+                const size_t i = std::upper_bound( offsets, offsets + numCrumbs, byteOffset ) - offsets - 1;
+
+                return i * breadcrumbInterval + Utf8::numChars( data + offsets[i], byteOffset - offsets[i] );
+            }
+        }
+
+        return Utf8::numChars( data, byteOffset );
+    }
+
     __li_member( Unicode::Char ) getChar( size_t& index ) const
     {
         Unicode::Char result;
@@ -746,7 +966,7 @@ namespace li
         if ( index >= getNumBytes() )
             return Unicode::invalidChar;
 
-        size_t length = Utf8::decode( result, data + index, getNumBytes() - index );
+        size_t length = Utf8::decode( result, getBuffer() + index, getNumBytes() - index );
 
         if ( length )
         {
@@ -757,21 +977,11 @@ namespace li
             return Unicode::invalidChar;
     }
 
-    __li_member( size_t ) getHash( const char* string )
+    __li_member( size_t ) getHash( const char* string, size_t numBytes )
     {
-        size_t hash = 0xE424AA76;
-
-        if ( string == nullptr )
-            return hash;
-
-        while ( *string )
-        {
-            //printf( "String: before char %u = '%c' hash = %08X\n", i, data[i], hash );
-            hash = ( ( hash << 13 ) | ( hash >> 19 ) ) ^ *string;
-            string++;
-        }
-
-        return hash;
+        // 0 is reserved to mark an empty hash cache
+        const size_t hash = static_cast<size_t>( hashBytes( string, numBytes, getProcessHashSeed() ) );
+        return ( hash != 0 ) ? hash : 1;
     }
 
     __li_member( StringTpl<blockSize> ) leftPart( size_t length ) const
@@ -779,19 +989,14 @@ namespace li
         if ( length == 0 )
             return StringTpl();
 
-        size_t index = 0;
-        StringTpl result;
-
-        for ( size_t i = 0; i < length; i++ )
-        {
-            Unicode::Char next = getChar( index );
-
-            if ( next == Unicode::invalidChar )
-                return result;
-            else
-                result.append( UnicodeChar( next ) );
-        }
+        return getSlice( 0, getByteOffset( length ), numChars >= 0 ? std::min<intptr_t>( numChars, static_cast<intptr_t>( length ) ) : -1 );
+    }
 
+    __li_member( StringTpl<blockSize> ) getSlice( size_t beginByte, size_t endByte, intptr_t numChars ) const
+    {
+        StringTpl result;
+        result.set( c_str() + beginByte, endByte - beginByte );
+        result.numChars = ( endByte > beginByte ) ? numChars : 0;
         return result;
     }
 
@@ -837,53 +1042,74 @@ namespace li
 
     __li_member( StringTpl<blockSize> ) replaceAll( const StringTpl& pattern, const StringTpl& replaceWith ) const
     {
-        size_t index = 0, patternLength = pattern.getNumCharsUncached();
-        StringTpl result;
+        const char* source = c_str();
+        const size_t patternBytes = pattern.numBytes, replaceBytes = replaceWith.numBytes;
 
-        while ( index < getNumBytes() )
+        intptr_t pos = StringView::findBytes( source, numBytes, pattern.c_str(), patternBytes );
+
+        if ( pos < 0 )
+            return *this;
+
+        // The output can only grow if the replacement is longer; count the matches to size it exactly
+        size_t outputBytes = numBytes;
+
+        if ( replaceBytes > patternBytes )
         {
-            int newIndex = findSubString( pattern, index );
+            for ( size_t index = pos; ; )
+            {
+                outputBytes += replaceBytes - patternBytes;
+                index += patternBytes;
 
-            if ( newIndex < 0 )
-                return result + dropLeftPart( index );
+                const intptr_t next = StringView::findBytes( source + index, numBytes - index, pattern.c_str(), patternBytes );
+
+                if ( next < 0 )
+                    break;
+
+                index += next;
+            }
+        }
+
+        StringTpl result;
+        result.setBuffer( outputBytes + 1 );
+
+        char* output = result.getBuffer();
+        size_t index = 0, numMatches = 0;
 
-            result += subString( index, newIndex - index ) + replaceWith;
-            index = newIndex + patternLength;
+        while ( pos >= 0 )
+        {
+            memcpy( output, source + index, pos );
+            memcpy( output + pos, replaceWith.c_str(), replaceBytes );
+            output += pos + replaceBytes;
+            index += pos + patternBytes;
+            numMatches++;
+
+            pos = StringView::findBytes( source + index, numBytes - index, pattern.c_str(), patternBytes );
         }
 
+        memcpy( output, source + index, numBytes - index );
+        output += numBytes - index;
+        *output = 0;
+
+        result.numBytes = output - result.getBuffer();
+
+        if ( numChars >= 0 && pattern.numChars >= 0 && replaceWith.numChars >= 0 )
+            result.numChars = numChars + static_cast<intptr_t>( numMatches ) * ( replaceWith.numChars - pattern.numChars );
+        else
+            result.numChars = -1;
+
         return result;
     }
 
     __li_member( StringTpl<blockSize> ) rightPart( size_t length ) const
     {
-        intptr_t cache = -1;
+        const size_t count = getNumChars();
 
-        if ( length > getNumCharsCached( cache ) )
-            length = getNumCharsCached( cache );
-        else if ( length == getNumCharsCached( cache ) )
+        if ( length >= count )
             return this;
         else if ( length == 0 )
             return StringTpl();
 
-        size_t index = 0;
-
-        for ( size_t i = 0; i < getNumCharsCached( cache ) - length; i++ )
-            if ( getChar( index ) == Unicode::invalidChar )
-                return StringTpl();
-
-        StringTpl result;
-
-        for ( size_t i = 0; i < length; i++ )
-        {
-            const Unicode::Char next = getChar( index );
-
-            if ( next == Unicode::invalidChar )
-                return result;
-            else
-                result.append( UnicodeChar( next ) );
-        }
-
-        return result;
+        return getSlice( getByteOffset( count - length ), numBytes, length );
     }
 
     __li_member( void ) set( const char* stringUtf8 )
@@ -894,7 +1120,7 @@ namespace li
             numBytes = strlen( stringUtf8 );
 
             setBuffer( numBytes + 1 );
-            strncpy( data, stringUtf8, numBytes + 1 );
+            strncpy( getBuffer(), stringUtf8, numBytes + 1 );
         }
         else
             clear();
@@ -908,8 +1134,8 @@ namespace li
             this->numBytes = numBytes;
 
             setBuffer( numBytes + 1 );
-            strncpy( data, stringUtf8, numBytes );
-            data[numBytes] = 0;
+            strncpy( getBuffer(), stringUtf8, numBytes );
+            getBuffer()[numBytes] = 0;
         }
         else
             clear();
@@ -922,26 +1148,86 @@ namespace li
 
         setBuffer( ( numBytes == 0 ) ? 0 : ( numBytes + 1 ) );
 
-        if ( data && other.data )
-            strncpy( data, other.data, numBytes + 1 );
+        if ( getBuffer() && other.getBuffer() )
+            strncpy( getBuffer(), other.getBuffer(), numBytes + 1 );
     }
 
     __li_member( void ) setBuffer( size_t requestedCapacity )
     {
+        if ( requestedCapacity == 0 )
+        {
+            releaseHeapBuffer();
+
+            heap.data = nullptr;
+            setLocal( false );
+            return;
+        }
+
+        if ( requestedCapacity <= localCapacity )
+        {
+            // Shrinking a heap string back to the local buffer keeps the leading bytes, as realloc would
+            if ( hasHeapBuffer() )
+            {
+                char* oldData = heap.data;
+                HeapHeader* oldHeader = getHeapHeader();
+                invalidateCaches();
+                oldHeader->~HeapHeader();
+
+                memcpy( local, oldData, requestedCapacity );
+                free( oldHeader );
+            }
+
+            setLocal( true );
+
+            // The local bytes may still hold a stale heap pointer, so always re-terminate
+            if ( numBytes < requestedCapacity )
+                local[numBytes] = 0;
+
+            return;
+        }
+
         // Round-up to a multiple of block size
-        size_t newCapacity = ( requestedCapacity == 0 ) ? 0 : ( ( requestedCapacity & ~( blockSize - 1 ) ) + blockSize );
+        size_t newCapacity = ( requestedCapacity & ~( blockSize - 1 ) ) + blockSize;
+
+        if ( isLocal() )
+        {
+            HeapHeader* header = reinterpret_cast<HeapHeader*>( malloc( sizeof( HeapHeader ) + newCapacity ) );
+
+            if ( header == nullptr )
+                abort();
 
-        if ( newCapacity != capacity )
+            new ( static_cast<void*>( header ) ) HeapHeader();
+            char* newData = reinterpret_cast<char*>( header + 1 );
+
+            memcpy( newData, local, localCapacity );
+            setLocal( false );
+            heap.data = newData;
+            heap.capacity = newCapacity;
+        }
+        else if ( heap.data == nullptr || newCapacity != heap.capacity )
         {
-            capacity = newCapacity;
+            // The caches are dropped rather than relocated along with the block
+            HeapHeader* oldHeader = nullptr;
+
+            if ( heap.data != nullptr )
+            {
+                invalidateCaches();
+                oldHeader = getHeapHeader();
+                oldHeader->~HeapHeader();
+            }
 
-            char* newData = reinterpret_cast<char*>( realloc( data, capacity ) );
+            HeapHeader* header = reinterpret_cast<HeapHeader*>( realloc( oldHeader, sizeof( HeapHeader ) + newCapacity ) );
 
-            if ( newData == nullptr )
+            if ( header == nullptr )
                 abort();
 
-            data = newData;
+            new ( static_cast<void*>( header ) ) HeapHeader();
+            heap.data = reinterpret_cast<char*>( header + 1 );
+            heap.capacity = newCapacity;
         }
+
+        if ( numBytes < newCapacity )
+            heap.data[numBytes] = 0;
     }
 
     __li_member( void ) split( Unicode::Char separator, StringTpl& leftSide, StringTpl& rightSide, bool rightDefault )
@@ -995,30 +1281,15 @@ namespace li
         if ( length == 0 )
             return StringTpl();
 
-        size_t index = 0;
-
-        for ( size_t i = 0; i < begin; i++ )
-            if ( getChar( index ) == Unicode::invalidChar )
-                return StringTpl();
-
-        StringTpl result;
-
-        for ( size_t i = 0; i < length; i++ )
-        {
-            const Unicode::Char next = getChar( index );
-
-            if ( next == Unicode::invalidChar )
-                return result;
-            else
-                result.append( UnicodeChar( next ) );
-        }
+        const size_t beginByte = getByteOffset( begin );
+        const size_t endByte = ( length < SIZE_MAX - begin ) ? getByteOffset( begin + length ) : numBytes;
 
-        return result;
+        return getSlice( beginByte, endByte );
     }
 
     __li_member( int ) toAscii( Array<char>& output )
     {
-        if ( !data )
+        if ( !getBuffer() )
             return 0;
 
         size_t index = 0, chars = 0;
@@ -1068,8 +1339,107 @@ namespace li
 #undef __li_member
 #undef __li_member_
 
+    // The inline buffer is located by a flag rather than a self-pointer, and the atomic caches live in the heap block,
+    // so the object itself is plain data that may be moved with memcpy
+    template <int blockSize>
+    struct IsTriviallyRelocatable<StringTpl<blockSize>> : std::true_type
+    {
+    };
+
     typedef StringTpl<> String;
 
+    static_assert( sizeof( String ) == 4 * sizeof( size_t ), "String must stay 4 words; keep caches in the heap block" );
+
+    // Seeded hasher for HashMap/FlatHashMap; also hashes C strings, so they can be looked up without building a String.
+    // With the default (process) seed, it reuses the hash cached in the String.
+    template <int blockSize>
+    struct Hasher<StringTpl<blockSize>, void>
+    {
+        typedef void is_transparent;
+
+        uint64_t seed;
+        bool useCachedHash;
+
+        Hasher() : seed( getProcessHashSeed() ), useCachedHash( true ) {}
+        Hasher( uint64_t seed ) : seed( seed ), useCachedHash( seed == getProcessHashSeed() ) {}
+
+        size_t operator()( const StringTpl<blockSize>& key ) const
+        {
+            if ( useCachedHash )
+                return key.getHash();
+
+            return static_cast<size_t>( hashBytes( key.c_str(), key.getNumBytes(), seed ) );
+        }
+
+        size_t operator()( const StringView& key ) const
+        {
+            if ( useCachedHash )
+                return key.getHash();
+
+            return static_cast<size_t>( hashBytes( key.getData(), key.getNumBytes(), seed ) );
+        }
+
+        size_t operator()( const char* key ) const
+        {
+            const size_t numBytes = key ? strlen( key ) : 0;
+
+            if ( useCachedHash )
+                return StringTpl<blockSize>::getHash( key, numBytes );
+
+            return static_cast<size_t>( hashBytes( key, numBytes, seed ) );
+        }
+    };
+
+    // Collects many appends into one geometrically grown buffer and hands it off as a String without copying
+    template <int blockSize = 0x10> class StringBuilderTpl
+    {
+        StringTpl<blockSize> string;
+
+        public:
+            StringBuilderTpl( size_t initialCapacity = 0 )
+            {
+                string.reserve( initialCapacity );
+            }
+
+            template <typename T> StringBuilderTpl& append( T value )
+            {
+                string.append( value );
+                return *this;
+            }
+
+            StringBuilderTpl& append( const char* stringUtf8, size_t numBytes )
+            {
+                string.append( stringUtf8, numBytes );
+                return *this;
+            }
+
+            template <typename T> StringBuilderTpl& appendNumber( T num )
+            {
+                string.appendNumber( num );
+                return *this;
+            }
+
+            const char* c_str() const { return string.c_str(); }
+            void clear() { string.clear(); }
+            size_t getNumBytes() const { return string.getNumBytes(); }
+            void reserve( size_t minCapacity ) { string.reserve( minCapacity ); }
+
+            // Leaves the builder empty
+            StringTpl<blockSize> toString()
+            {
+                StringTpl<blockSize> result( ( StringTpl<blockSize>&& ) string );
+                return result;
+            }
+
+            template <typename T> StringBuilderTpl& operator << ( T value )
+            {
+                string += value;
+                return *this;
+            }
+    };
+
+    typedef StringBuilderTpl<> StringBuilder;
+
     template <typename T> String operator + ( T left, const String& right )
     {
         return String( left ) + right;
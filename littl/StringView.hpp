@@ -0,0 +1,346 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <littl/Hash.hpp>
+#include <littl/List.hpp>
+#include <littl/Utf8.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define li_StringView_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace li
+{
+    template <int blockSize> class StringTpl;
+
+    // Non-owning view of a UTF-8 byte range. Not necessarily NUL-terminated.
+    // Slicing and tokenizing a view never allocates; construct a String from a view to get an owned copy.
+    // A view must not outlive the buffer it points into.
+    class StringView
+    {
+        template <int blockSize> friend class StringTpl;
+
+        const char* data;
+        size_t numBytes;
+        // -1 if unknown; only cached by the non-const getNumChars(), so that const views can be shared between threads
+        intptr_t numChars;
+
+        // Byte offset of the character at charIndex (clamped to numBytes)
+        size_t getByteOffset( size_t charIndex ) const
+        {
+            if ( numChars >= 0 && static_cast<size_t>( numChars ) == numBytes )
+                return std::min( charIndex, numBytes );
+
+            size_t i = Utf8::numAsciiBytes( data, std::min( charIndex, numBytes ) );
+            charIndex -= i;
+
+            for ( ; i < numBytes && charIndex > 0; charIndex-- )
+            {
+                i++;
+
+                while ( i < numBytes && ( data[i] & 0xC0 ) == 0x80 )
+                    i++;
+            }
+
+            return i;
+        }
+
+        intptr_t findBytes( const char* pattern, size_t patternLength, size_t byteOffset ) const
+        {
+            const intptr_t pos = findBytes( data + byteOffset, numBytes - byteOffset, pattern, patternLength );
+            return ( pos >= 0 ) ? pos + byteOffset : -1;
+        }
+
+        // leftSide or rightSide may alias *this
+        void splitAt( intptr_t byteOffset, size_t separatorLength, StringView& leftSide, StringView& rightSide, bool rightDefault ) const
+        {
+            StringView outputLeft, outputRight;
+
+            if ( byteOffset < 0 )
+            {
+                if ( rightDefault )
+                    outputRight = *this;
+                else
+                    outputLeft = *this;
+            }
+            else
+            {
+                const size_t rightBegin = byteOffset + separatorLength;
+
+                outputLeft = StringView( data, byteOffset );
+                outputRight = StringView( data + rightBegin, numBytes - rightBegin );
+            }
+
+            leftSide = outputLeft;
+            rightSide = outputRight;
+        }
+
+        const char* toNumberBuffer( char* buffer, size_t bufferSize ) const
+        {
+            const size_t length = std::min( numBytes, bufferSize - 1 );
+
+            if ( length > 0 )
+                memcpy( buffer, data, length );
+
+            buffer[length] = 0;
+            return buffer;
+        }
+
+        StringView( const char* data, size_t numBytes, intptr_t numChars ) : data( data ), numBytes( numBytes ), numChars( numChars )
+        {
+        }
+
+        public:
+            StringView() : data( nullptr ), numBytes( 0 ), numChars( 0 )
+            {
+            }
+
+            StringView( const char* stringUtf8 ) : data( stringUtf8 ), numBytes( stringUtf8 ? strlen( stringUtf8 ) : 0 ), numChars( -1 )
+            {
+            }
+
+            StringView( const char* stringUtf8, size_t numBytes ) : data( stringUtf8 ), numBytes( numBytes ), numChars( -1 )
+            {
+            }
+
+            template <int blockSize>
+            StringView( const StringTpl<blockSize>& string ) : data( string.c_str() ), numBytes( string.getNumBytes() ), numChars( -1 )
+            {
+            }
+
+            // Byte offset of the first occurrence of needle, or -1. An empty needle is never found.
+            static intptr_t findBytes( const char* haystack, size_t haystackLength, const char* needle, size_t needleLength )
+            {
+                if ( needleLength == 0 || needleLength > haystackLength )
+                    return -1;
+
+                if ( needleLength == 1 )
+                {
+                    const char* p = static_cast<const char*>( memchr( haystack, needle[0], haystackLength ) );
+                    return ( p != nullptr ) ? p - haystack : -1;
+                }
+
+                // Last position where the needle could begin
+                const size_t lastBegin = haystackLength - needleLength;
+                size_t i = 0;
+
+#ifdef li_StringView_SSE2
+                // Test 16 positions at once against the first and last needle byte; only candidates matching both are compared
+                const __m128i first = _mm_set1_epi8( needle[0] );
+                const __m128i last = _mm_set1_epi8( needle[needleLength - 1] );
+
+                for ( ; i + 16 <= lastBegin + 1; i += 16 )
+                {
+                    const __m128i blockFirst = _mm_loadu_si128( reinterpret_cast<const __m128i*>( haystack + i ) );
+                    const __m128i blockLast = _mm_loadu_si128( reinterpret_cast<const __m128i*>( haystack + i + needleLength - 1 ) );
+
+                    uint32_t mask = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( blockFirst, first ), _mm_cmpeq_epi8( blockLast, last ) ) );
+
+                    for ( ; mask != 0; mask &= mask - 1 )
+                    {
+                        const size_t candidate = i + Utf8Detail::countTrailingZeros( mask );
+
+                        if ( memcmp( haystack + candidate + 1, needle + 1, needleLength - 2 ) == 0 )
+                            return candidate;
+                    }
+                }
+#endif
+
+                for ( ; i <= lastBegin; i++ )
+                {
+                    const char* p = static_cast<const char*>( memchr( haystack + i, needle[0], lastBegin - i + 1 ) );
+
+                    if ( p == nullptr )
+                        return -1;
+
+                    i = p - haystack;
+
+                    if ( haystack[i + needleLength - 1] == needle[needleLength - 1] && memcmp( p + 1, needle + 1, needleLength - 2 ) == 0 )
+                        return i;
+                }
+
+                return -1;
+            }
+
+            bool beginsWith( Unicode::Char c ) const
+            {
+                Unicode::Char first;
+                return numBytes > 0 && Utf8::decode( first, data, numBytes ) > 0 && first == c;
+            }
+
+            bool beginsWith( const StringView& other ) const
+            {
+                return other.numBytes <= numBytes && memcmp( data, other.data, other.numBytes ) == 0;
+            }
+
+            StringView dropLeftPart( size_t length ) const
+            {
+                const size_t offset = getByteOffset( length );
+                return StringView( data + offset, numBytes - offset, numChars >= 0 ? std::max<intptr_t>( numChars - static_cast<intptr_t>( length ), 0 ) : -1 );
+            }
+
+            StringView dropRightPart( size_t length ) const
+            {
+                const size_t count = getNumChars();
+                return leftPart( length < count ? count - length : 0 );
+            }
+
+            bool endsWith( const StringView& other ) const
+            {
+                return other.numBytes <= numBytes && memcmp( data + numBytes - other.numBytes, other.data, other.numBytes ) == 0;
+            }
+
+            bool equals( const StringView& other ) const
+            {
+                return numBytes == other.numBytes && memcmp( data, other.data, numBytes ) == 0;
+            }
+
+            intptr_t findChar( Unicode::Char c, size_t beginAt = 0 ) const
+            {
+                char encoded[7];
+                const size_t length = Utf8::encode( c, encoded );
+                const intptr_t pos = findBytes( encoded, length, getByteOffset( beginAt ) );
+
+                return ( pos >= 0 ) ? Utf8::numChars( data, pos ) : -1;
+            }
+
+            intptr_t findSubString( const StringView& pattern, size_t beginAt = 0 ) const
+            {
+                const intptr_t pos = findBytes( pattern.data, pattern.numBytes, getByteOffset( beginAt ) );
+
+                return ( pos >= 0 ) ? Utf8::numChars( data, pos ) : -1;
+            }
+
+            const char* getData() const { return data; }
+
+            size_t getHash() const
+            {
+                // Same as StringTpl::getHash, so views can look up String keys
+                const size_t hash = static_cast<size_t>( hashBytes( data, numBytes, getProcessHashSeed() ) );
+                return ( hash != 0 ) ? hash : 1;
+            }
+
+            size_t getNumBytes() const { return numBytes; }
+
+            size_t getNumChars()
+            {
+                if ( numChars < 0 )
+                    numChars = Utf8::numChars( data, numBytes );
+
+                return numChars;
+            }
+
+            size_t getNumChars() const
+            {
+                return ( numChars >= 0 ) ? numChars : Utf8::numChars( data, numBytes );
+            }
+
+            bool isEmpty() const { return numBytes == 0; }
+
+            StringView leftPart( size_t length ) const
+            {
+                return StringView( data, getByteOffset( length ), numChars >= 0 ? std::min<intptr_t>( numChars, static_cast<intptr_t>( length ) ) : -1 );
+            }
+
+            // Tokens are views into this view. Escapes are not supported, since they would require a copy.
+            unsigned parse( List<StringView>& tokens, Unicode::Char separator, bool strict = false ) const
+            {
+                char encoded[7];
+                const size_t separatorLength = Utf8::encode( separator, encoded );
+                unsigned numTokens = 0;
+
+                for ( size_t begin = 0; ; )
+                {
+                    const intptr_t pos = findBytes( encoded, separatorLength, begin );
+                    const size_t end = ( pos >= 0 ) ? pos : numBytes;
+
+                    if ( strict || end > begin )
+                    {
+                        tokens.add( StringView( data + begin, end - begin ) );
+                        numTokens++;
+                    }
+
+                    if ( pos < 0 )
+                        break;
+
+                    begin = end + separatorLength;
+                }
+
+                return numTokens;
+            }
+
+            StringView rightPart( size_t length ) const
+            {
+                const size_t count = getNumChars();
+                return dropLeftPart( length < count ? count - length : 0 );
+            }
+
+            void split( Unicode::Char separator, StringView& leftSide, StringView& rightSide, bool rightDefault = false ) const
+            {
+                char encoded[7];
+                const size_t separatorLength = Utf8::encode( separator, encoded );
+
+                splitAt( findBytes( encoded, separatorLength, 0 ), separatorLength, leftSide, rightSide, rightDefault );
+            }
+
+            void split( const StringView& separator, StringView& leftSide, StringView& rightSide, bool rightDefault = false ) const
+            {
+                splitAt( findBytes( separator.data, separator.numBytes, 0 ), separator.numBytes, leftSide, rightSide, rightDefault );
+            }
+
+            StringView subString( size_t begin, size_t length ) const
+            {
+                return dropLeftPart( begin ).leftPart( length );
+            }
+
+            long toInt() const
+            {
+                char buffer[32];
+                return strtol( toNumberBuffer( buffer, sizeof( buffer ) ), nullptr, 0 );
+            }
+
+            uint64_t toUnsigned() const
+            {
+                char buffer[32];
+                return strtoull( toNumberBuffer( buffer, sizeof( buffer ) ), nullptr, 0 );
+            }
+
+
+            bool operator == ( const StringView& other ) const { return equals( other ); }
+            bool operator != ( const StringView& other ) const { return !equals( other ); }
+    };
+
+    template <>
+    struct Hasher<StringView, void>
+    {
+        typedef void is_transparent;
+
+        size_t operator()( const StringView& key ) const { return key.getHash(); }
+    };
+}
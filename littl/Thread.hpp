@@ -30,33 +30,134 @@
 #include "ThreadPthread.hpp"
 #endif
 
+#include <atomic>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define li_Thread_SSE2
+#endif
+
 namespace li
 {
-    class CriticalSection
+    // Hint to the CPU that we're busy-waiting (frees resources for the sibling hyperthread)
+    inline void cpuRelax()
+    {
+#if defined( li_Thread_SSE2 )
+        _mm_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+        __asm__ __volatile__( "yield" );
+#endif
+    }
+
+    // Test-and-test-and-set spinlock for critical sections of a few dozen instructions.
+    // Waiters spin on a plain load (keeping the cache line shared) and yield the CPU after a while,
+    // so a preempted owner doesn't stall them indefinitely. Not recursive.
+    class SpinLock
     {
-        Mutex* mutex;
+        std::atomic<bool> locked;
+
+        SpinLock( const SpinLock& );
+        SpinLock& operator = ( const SpinLock& );
 
         public:
-            CriticalSection( Mutex* mutex ) : mutex( mutex )
+            SpinLock() : locked( false )
             {
-                mutex->enter();
             }
 
-            CriticalSection( Mutex& mutex ) : mutex( &mutex )
+            void enter()
             {
-                mutex.enter();
+                for ( ;; )
+                {
+                    if ( !locked.exchange( true, std::memory_order_acquire ) )
+                        return;
+
+                    // Each time the lock is seen taken, spin briefly again before falling back to yielding
+                    for ( unsigned spins = 0; locked.load( std::memory_order_relaxed ); )
+                    {
+                        if ( ++spins < 1000 )
+                            cpuRelax();
+                        else
+                            yieldThread();
+                    }
+                }
             }
 
-            ~CriticalSection()
+            bool tryEnter()
             {
-                if ( mutex != nullptr )
-                    mutex->leave();
+                return !locked.load( std::memory_order_relaxed ) && !locked.exchange( true, std::memory_order_acquire );
             }
 
             void leave()
             {
-                mutex->leave();
-                mutex = nullptr;
+                locked.store( false, std::memory_order_release );
             }
     };
+
+    // Holds any lock with enter()/leave() (Mutex, FastMutex, RWLock, SpinLock) for the lifetime of the object
+    template <class Lock>
+    class ScopedLock
+    {
+        Lock* lock;
+
+        ScopedLock( const ScopedLock& );
+        ScopedLock& operator = ( const ScopedLock& );
+
+        public:
+            ScopedLock( Lock* lock ) : lock( lock )
+            {
+                lock->enter();
+            }
+
+            ScopedLock( Lock& lock ) : lock( &lock )
+            {
+                lock.enter();
+            }
+
+            ~ScopedLock()
+            {
+                if ( lock != nullptr )
+                    lock->leave();
+            }
+
+            void leave()
+            {
+                lock->leave();
+                lock = nullptr;
+            }
+    };
+
+    // Same for the shared side of an RWLock
+    template <class Lock>
+    class SharedScopedLock
+    {
+        Lock* lock;
+
+        SharedScopedLock( const SharedScopedLock& );
+        SharedScopedLock& operator = ( const SharedScopedLock& );
+
+        public:
+            SharedScopedLock( Lock* lock ) : lock( lock )
+            {
+                lock->enterShared();
+            }
+
+            SharedScopedLock( Lock& lock ) : lock( &lock )
+            {
+                lock.enterShared();
+            }
+
+            ~SharedScopedLock()
+            {
+                if ( lock != nullptr )
+                    lock->leaveShared();
+            }
+
+            void leave()
+            {
+                lock->leaveShared();
+                lock = nullptr;
+            }
+    };
+
+    typedef ScopedLock<Mutex> CriticalSection;
 }
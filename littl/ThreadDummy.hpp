@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace li
 {
     class Mutex
@@ -44,27 +46,141 @@ namespace li
             }
     };
 
+    class FastMutex
+    {
+        public:
+            void enter()
+            {
+            }
+
+            bool tryEnter()
+            {
+                return true;
+            }
+
+            void leave()
+            {
+            }
+    };
+
+    class RWLock
+    {
+        public:
+            void enter()
+            {
+            }
+
+            bool tryEnter()
+            {
+                return true;
+            }
+
+            void leave()
+            {
+            }
+
+            void enterShared()
+            {
+            }
+
+            bool tryEnterShared()
+            {
+                return true;
+            }
+
+            void leaveShared()
+            {
+            }
+    };
+
+    class Event
+    {
+        bool manualReset, state;
+
+        public:
+            Event( bool manualReset = false, bool initialState = false )
+                    : manualReset( manualReset ), state( initialState )
+            {
+            }
+
+            void reset()
+            {
+                state = false;
+            }
+
+            void set()
+            {
+                state = true;
+            }
+
+            bool wait( long time = -1 )
+            {
+                bool wasSet = state;
+
+                if ( !manualReset )
+                    state = false;
+
+                return wasSet;
+            }
+    };
+
+    // Without threads nobody could ever notify a waiter, so waits return immediately
     class ConditionVar
     {
+        Event event;
+
         public:
-            ConditionVar()
+            void notifyOne()
+            {
+            }
+
+            void notifyAll()
+            {
+            }
+
+            template <class Lock>
+            void wait( Lock& mutex )
+            {
+            }
+
+            template <class Lock, class Predicate>
+            void wait( Lock& mutex, Predicate pred )
             {
             }
 
-            ~ConditionVar()
+            template <class Lock>
+            bool waitFor( Lock& mutex, long time )
             {
+                return false;
+            }
+
+            template <class Lock, class Predicate>
+            bool waitFor( Lock& mutex, long time, Predicate pred )
+            {
+                return pred();
             }
 
             void set()
             {
+                event.set();
             }
 
-            bool waitFor()
+            bool waitFor( long time = -1 )
             {
-                return true;
+                return event.wait( time );
             }
     };
 
+    // There is no other thread to yield to
+    inline void yieldThread()
+    {
+    }
+
+    inline unsigned getNumHardwareThreads()
+    {
+        return 1;
+    }
+
     inline bool interlockedCompareExchange(volatile int32_t* value_ptr, int32_t compareTo, int32_t newValue)
     {
         auto ret = *value_ptr;
@@ -0,0 +1,430 @@
+/*
+    Copyright (C) 2016 Xeatheran Minexew
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <littl/List.hpp>
+#include <littl/Thread.hpp>
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace li
+{
+    class ThreadPool;
+
+    namespace ThreadPoolDetail
+    {
+        struct TaskBase
+        {
+            std::atomic<bool> done;
+            std::exception_ptr exception;
+
+            TaskBase() : done( false ) {}
+            virtual ~TaskBase() {}
+
+            virtual void run() = 0;
+        };
+
+        template <class Function>
+        struct Task : public TaskBase
+        {
+            Function function;
+
+            Task( Function&& function ) : function( std::move( function ) ) {}
+
+            virtual void run() override { function(); }
+        };
+
+        typedef std::shared_ptr<TaskBase> TaskPtr;
+    }
+
+    // Returned by ThreadPool::submit. Copies refer to the same task.
+    class TaskHandle
+    {
+        ThreadPool* pool;
+        ThreadPoolDetail::TaskPtr task;
+
+        friend class ThreadPool;
+
+        TaskHandle( ThreadPool* pool, ThreadPoolDetail::TaskPtr&& task ) : pool( pool ), task( std::move( task ) ) {}
+
+        public:
+            TaskHandle() : pool( nullptr ) {}
+
+            bool isDone() const { return task == nullptr || task->done.load( std::memory_order_acquire ); }
+
+            // Blocks until the task has finished, running other queued tasks meanwhile (so waiting from inside
+            // a task can't starve the pool). Rethrows whatever the task threw.
+            // The pool is only touched while the task is pending; still, don't wait on a handle whose pool is gone.
+            void wait();
+    };
+
+    // Fixed set of worker threads executing short tasks. Every worker owns a deque: it pushes and pops its own
+    // tasks at the back (LIFO, cache-warm), while idle workers steal from the front of the others.
+    // Tasks submitted from outside the pool are spread round-robin. Idle workers sleep on a condition variable.
+    // With littl_dummy_Thread no workers are started; queued tasks run in wait() or when the pool is destroyed.
+    class ThreadPool
+    {
+        typedef ThreadPoolDetail::TaskPtr TaskPtr;
+
+#ifndef littl_dummy_Thread
+        class Worker : public Thread
+        {
+            ThreadPool& pool;
+            unsigned index;
+
+            protected:
+                virtual void run() override { pool.workerLoop( index ); }
+
+            public:
+                Worker( ThreadPool& pool, unsigned index ) : pool( pool ), index( index ) {}
+        };
+#endif
+
+        struct alignas( 64 ) WorkQueue
+        {
+            FastMutex mutex;
+            std::deque<TaskPtr> tasks;
+        };
+
+#ifndef littl_dummy_Thread
+        List<Worker*> workers;
+#endif
+        std::unique_ptr<WorkQueue[]> queues;
+        unsigned numThreads;
+
+        std::atomic<unsigned> nextQueue;
+        std::atomic<intptr_t> numPending;
+        std::atomic<bool> stopping;
+
+        // Sleeping workers and waiters
+        FastMutex sleepMutex;
+        ConditionVar workCond, doneCond;
+        std::atomic<int> numIdle, numWaiting;
+
+        friend class TaskHandle;
+
+        ThreadPool( const ThreadPool& );
+        ThreadPool& operator =( const ThreadPool& );
+
+        struct WorkerIdentity
+        {
+            ThreadPool* pool;
+            unsigned index;
+        };
+
+        static WorkerIdentity& getCurrentWorker()
+        {
+            static thread_local WorkerIdentity current = { nullptr, 0 };
+            return current;
+        }
+
+        void enqueue( TaskPtr task )
+        {
+            const WorkerIdentity& self = getCurrentWorker();
+            unsigned index = ( self.pool == this ) ? self.index : nextQueue.fetch_add( 1, std::memory_order_relaxed ) % numThreads;
+
+            // Counted before it becomes visible, so a worker never goes to sleep while a task is queued
+            numPending.fetch_add( 1, std::memory_order_seq_cst );
+
+            {
+                ScopedLock<FastMutex> lock( queues[index].mutex );
+                queues[index].tasks.push_back( std::move( task ) );
+            }
+
+            const bool anyIdle = numIdle.load( std::memory_order_seq_cst ) > 0;
+            const bool anyWaiting = numWaiting.load( std::memory_order_seq_cst ) > 0;
+
+            if ( anyIdle || anyWaiting )
+            {
+                ScopedLock<FastMutex> lock( sleepMutex );
+
+                if ( anyIdle )
+                    workCond.notifyOne();
+
+                // Threads blocked in waitFor() can help with the new task
+                if ( anyWaiting )
+                    doneCond.notifyAll();
+            }
+        }
+
+        // Own queue from the back, then steal from the front of the others
+        TaskPtr findTask( unsigned self )
+        {
+            for ( unsigned i = 0; i < numThreads; i++ )
+            {
+                unsigned index = ( self + i ) % numThreads;
+                WorkQueue& queue = queues[index];
+
+                ScopedLock<FastMutex> lock( queue.mutex );
+
+                if ( queue.tasks.empty() )
+                    continue;
+
+                TaskPtr task;
+
+                if ( i == 0 )
+                {
+                    task = std::move( queue.tasks.back() );
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move( queue.tasks.front() );
+                    queue.tasks.pop_front();
+                }
+
+                numPending.fetch_sub( 1, std::memory_order_relaxed );
+                return task;
+            }
+
+            return nullptr;
+        }
+
+        void execute( ThreadPoolDetail::TaskBase& task )
+        {
+            try
+            {
+                task.run();
+            }
+            catch ( ... )
+            {
+                task.exception = std::current_exception();
+            }
+
+            task.done.store( true, std::memory_order_release );
+
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+
+            if ( numWaiting.load( std::memory_order_relaxed ) > 0 )
+            {
+                ScopedLock<FastMutex> lock( sleepMutex );
+                doneCond.notifyAll();
+            }
+        }
+
+        bool runPendingTask()
+        {
+            const WorkerIdentity& self = getCurrentWorker();
+            TaskPtr task = findTask( ( self.pool == this ) ? self.index : 0 );
+
+            if ( task == nullptr )
+                return false;
+
+            execute( *task );
+            return true;
+        }
+
+        void workerLoop( unsigned index )
+        {
+            getCurrentWorker() = WorkerIdentity { this, index };
+
+            for ( ;; )
+            {
+                TaskPtr task = findTask( index );
+
+                if ( task != nullptr )
+                {
+                    execute( *task );
+                    continue;
+                }
+
+                ScopedLock<FastMutex> lock( sleepMutex );
+                numIdle.fetch_add( 1, std::memory_order_seq_cst );
+
+                while ( numPending.load( std::memory_order_seq_cst ) <= 0 && !stopping.load() )
+                    workCond.wait( sleepMutex );
+
+                numIdle.fetch_sub( 1, std::memory_order_relaxed );
+
+                // Queued tasks are drained before the pool shuts down
+                if ( stopping.load() && numPending.load() <= 0 )
+                    break;
+            }
+
+            getCurrentWorker() = WorkerIdentity { nullptr, 0 };
+        }
+
+        void waitFor( const ThreadPoolDetail::TaskBase& task )
+        {
+            while ( !task.done.load( std::memory_order_acquire ) )
+            {
+                if ( runPendingTask() )
+                    continue;
+
+                // Nothing to help with: sleep until some task completes or more work is queued
+                ScopedLock<FastMutex> lock( sleepMutex );
+                numWaiting.fetch_add( 1, std::memory_order_seq_cst );
+
+                if ( !task.done.load( std::memory_order_acquire ) && numPending.load() <= 0 )
+                    doneCond.wait( sleepMutex );
+
+                numWaiting.fetch_sub( 1, std::memory_order_relaxed );
+            }
+        }
+
+        public:
+            // Starts `numThreads` workers; 0 means one per hardware thread
+            ThreadPool( unsigned numThreads = 0 )
+                    : numThreads( numThreads ), nextQueue( 0 ), numPending( 0 ), stopping( false ), numIdle( 0 ), numWaiting( 0 )
+            {
+                if ( this->numThreads == 0 )
+                    this->numThreads = getNumHardwareThreads();
+
+                queues.reset( new WorkQueue[this->numThreads] );
+
+#ifndef littl_dummy_Thread
+                for ( unsigned i = 0; i < this->numThreads; i++ )
+                {
+                    auto worker = new Worker( *this, i );
+
+                    if ( worker->start() )
+                        workers.add( worker );
+                    else
+                        delete worker;
+                }
+#endif
+            }
+
+            // Finishes all queued tasks, then joins the workers
+            ~ThreadPool()
+            {
+                {
+                    ScopedLock<FastMutex> lock( sleepMutex );
+                    stopping.store( true );
+                    workCond.notifyAll();
+                }
+
+#ifndef littl_dummy_Thread
+                for ( auto worker : workers )
+                {
+                    worker->waitFor();
+                    delete worker;
+                }
+#endif
+
+                // In case no worker could be started
+                while ( runPendingTask() )
+                    ;
+            }
+
+            unsigned getNumThreads() const { return numThreads; }
+
+            // Queues `function()` for execution. Tasks submitted from a worker go to its own deque.
+            template <class Function>
+            TaskHandle submit( Function function )
+            {
+                TaskPtr task = std::make_shared<ThreadPoolDetail::Task<Function>>( std::move( function ) );
+                enqueue( task );
+                return TaskHandle( this, std::move( task ) );
+            }
+
+            // Calls `function( i )` for every i in [begin, end) across the pool and the calling thread.
+            // Indices are handed out in chunks of `grainSize` (by default, enough for 8 chunks per thread)
+            // from a shared counter, so uneven iterations balance out.
+            template <class Function>
+            void parallelFor( size_t begin, size_t end, Function function, size_t grainSize = 0 )
+            {
+                if ( begin >= end )
+                    return;
+
+                size_t count = end - begin;
+
+                if ( grainSize == 0 )
+                    grainSize = ( count + numThreads * 8 - 1 ) / ( numThreads * 8 );
+
+                std::atomic<size_t> next( begin );
+
+                auto body = [&]
+                {
+                    for ( ;; )
+                    {
+                        size_t chunkBegin = next.fetch_add( grainSize, std::memory_order_relaxed );
+
+                        if ( chunkBegin >= end )
+                            break;
+
+                        size_t chunkEnd = ( end - chunkBegin > grainSize ) ? chunkBegin + grainSize : end;
+
+                        for ( size_t i = chunkBegin; i < chunkEnd; i++ )
+                            function( i );
+                    }
+                };
+
+                size_t numChunks = ( count + grainSize - 1 ) / grainSize;
+                unsigned numHelpers = ( numChunks - 1 < numThreads ) ? static_cast<unsigned>( numChunks - 1 ) : numThreads;
+
+                List<TaskHandle> helpers;
+
+                for ( unsigned i = 0; i < numHelpers; i++ )
+                    helpers.add( submit( body ) );
+
+                std::exception_ptr exception;
+
+                try
+                {
+                    body();
+                }
+                catch ( ... )
+                {
+                    // Let the helpers run out of indices before unwinding their captured state
+                    next.store( end );
+                    exception = std::current_exception();
+                }
+
+                for ( auto& helper : helpers )
+                {
+                    try
+                    {
+                        helper.wait();
+                    }
+                    catch ( ... )
+                    {
+                        next.store( end );
+
+                        if ( !exception )
+                            exception = std::current_exception();
+                    }
+                }
+
+                if ( exception )
+                    std::rethrow_exception( exception );
+            }
+    };
+
+    inline void TaskHandle::wait()
+    {
+        if ( task == nullptr )
+            return;
+
+        if ( !task->done.load( std::memory_order_acquire ) )
+            pool->waitFor( *task );
+
+        if ( task->exception )
+            std::rethrow_exception( task->exception );
+    }
+}
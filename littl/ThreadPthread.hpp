@@ -24,7 +24,12 @@
 
 #include <littl/Base.hpp>
 
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 
 #ifdef li_Apple
 #include <libkern/OSAtomic.h>
@@ -244,40 +249,319 @@ namespace li
             {
                 pthread_mutex_unlock(&mutex);
             }
+
+            pthread_mutex_t* getNativeHandle()
+            {
+                return &mutex;
+            }
+    };
+
+    // Non-recursive mutex: cheaper than Mutex, but deadlocks if entered twice by the same thread.
+    // On glibc it spins briefly before sleeping, which pays off for short critical sections.
+    class FastMutex
+    {
+        pthread_mutex_t mutex;
+
+        FastMutex( const FastMutex& );
+        FastMutex& operator = ( const FastMutex& );
+
+        public:
+            FastMutex()
+            {
+                pthread_mutexattr_t mta;
+
+                pthread_mutexattr_init(&mta);
+#if defined(PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP)
+                pthread_mutexattr_settype(&mta, PTHREAD_MUTEX_ADAPTIVE_NP);
+#endif
+                pthread_mutex_init(&mutex, &mta);
+                pthread_mutexattr_destroy(&mta);
+            }
+
+            ~FastMutex()
+            {
+                pthread_mutex_destroy(&mutex);
+            }
+
+            void enter()
+            {
+                pthread_mutex_lock(&mutex);
+            }
+
+            bool tryEnter()
+            {
+                return pthread_mutex_trylock(&mutex) == 0;
+            }
+
+            void leave()
+            {
+                pthread_mutex_unlock(&mutex);
+            }
+
+            pthread_mutex_t* getNativeHandle()
+            {
+                return &mutex;
+            }
     };
 
+    // Reader/writer lock for read-mostly data: any number of threads may hold it shared, or one exclusively
+    class RWLock
+    {
+        pthread_rwlock_t lock;
+
+        RWLock( const RWLock& );
+        RWLock& operator = ( const RWLock& );
+
+        public:
+            RWLock()
+            {
+                pthread_rwlock_init(&lock, NULL);
+            }
+
+            ~RWLock()
+            {
+                pthread_rwlock_destroy(&lock);
+            }
+
+            void enter()
+            {
+                pthread_rwlock_wrlock(&lock);
+            }
+
+            bool tryEnter()
+            {
+                return pthread_rwlock_trywrlock(&lock) == 0;
+            }
+
+            void leave()
+            {
+                pthread_rwlock_unlock(&lock);
+            }
+
+            void enterShared()
+            {
+                pthread_rwlock_rdlock(&lock);
+            }
+
+            bool tryEnterShared()
+            {
+                return pthread_rwlock_tryrdlock(&lock) == 0;
+            }
+
+            void leaveShared()
+            {
+                pthread_rwlock_unlock(&lock);
+            }
+    };
+
+    namespace ThreadDetail
+    {
+        // Condition variables wait against the monotonic clock, so changing the wall clock doesn't affect timeouts
+        inline void initCondition( pthread_cond_t* cond )
+        {
+            pthread_condattr_t attr;
+
+            pthread_condattr_init(&attr);
+#if !defined(__APPLE__)
+            pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+            pthread_cond_init(cond, &attr);
+            pthread_condattr_destroy(&attr);
+        }
+
+        inline timespec getDeadline( long time )
+        {
+            timespec deadline;
+
+#if defined(__APPLE__)
+            clock_gettime(CLOCK_REALTIME, &deadline);
+#else
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+#endif
+
+            deadline.tv_sec += time / 1000;
+            deadline.tv_nsec += ( time % 1000 ) * 1000000L;
+
+            if ( deadline.tv_nsec >= 1000000000L )
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+
+            return deadline;
+        }
+
+        // Waits once; returns false on timeout. A null deadline waits forever.
+        inline bool waitCondition( pthread_cond_t* cond, pthread_mutex_t* mutex, const timespec* deadline )
+        {
+            if ( deadline == nullptr )
+                return pthread_cond_wait(cond, mutex) == 0;
+            else
+                return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+        }
+    }
+
+    // Auto-reset (wakes one waiter, then clears itself) or manual-reset (stays set until reset()) event.
+    // Unlike a bare condition variable it remembers a set() that arrives before anybody waits.
+    class Event
+    {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        bool manualReset, state;
+
+        Event( const Event& );
+        Event& operator = ( const Event& );
+
+        public:
+            Event( bool manualReset = false, bool initialState = false )
+                    : manualReset( manualReset ), state( initialState )
+            {
+                pthread_mutex_init(&mutex, NULL);
+                ThreadDetail::initCondition(&cond);
+            }
+
+            ~Event()
+            {
+                pthread_cond_destroy(&cond);
+                pthread_mutex_destroy(&mutex);
+            }
+
+            void reset()
+            {
+                pthread_mutex_lock(&mutex);
+                state = false;
+                pthread_mutex_unlock(&mutex);
+            }
+
+            void set()
+            {
+                pthread_mutex_lock(&mutex);
+                state = true;
+
+                if ( manualReset )
+                    pthread_cond_broadcast(&cond);
+                else
+                    pthread_cond_signal(&cond);
+
+                pthread_mutex_unlock(&mutex);
+            }
+
+            // Returns false if `time` milliseconds passed without the event being set
+            bool wait( long time = -1 )
+            {
+                timespec deadline;
+
+                if ( time >= 0 )
+                    deadline = ThreadDetail::getDeadline( time );
+
+                pthread_mutex_lock(&mutex);
+
+                while ( !state )
+                    if ( !ThreadDetail::waitCondition(&cond, &mutex, time >= 0 ? &deadline : nullptr) )
+                        break;
+
+                bool wasSet = state;
+
+                if ( wasSet && !manualReset )
+                    state = false;
+
+                pthread_mutex_unlock(&mutex);
+                return wasSet;
+            }
+    };
+
+    // Condition variable used together with a Mutex or FastMutex held by the caller.
+    // (A Mutex must be entered exactly once by the waiting thread, since waiting releases it only once.)
+    //
+    // set() and waitFor() without a mutex behave like an auto-reset Event, as they do on Windows.
     class ConditionVar
     {
-        pthread_mutex_t waiting;
         pthread_cond_t cond;
+        Event event;
+
+        ConditionVar( const ConditionVar& );
+        ConditionVar& operator = ( const ConditionVar& );
 
         public:
             ConditionVar()
             {
-                waiting = PTHREAD_MUTEX_INITIALIZER;
-                cond = PTHREAD_COND_INITIALIZER;
+                ThreadDetail::initCondition(&cond);
             }
 
             ~ConditionVar()
             {
+                pthread_cond_destroy(&cond);
             }
 
-            void set()
+            void notifyOne()
             {
-                pthread_mutex_lock(&waiting);
                 pthread_cond_signal(&cond);
-                pthread_mutex_unlock(&waiting);
             }
 
-            bool waitFor()
+            void notifyAll()
+            {
+                pthread_cond_broadcast(&cond);
+            }
+
+            // Releases `mutex` and waits for a notification (or a spurious wakeup), then re-enters it
+            template <class Lock>
+            void wait( Lock& mutex )
+            {
+                ThreadDetail::waitCondition(&cond, mutex.getNativeHandle(), nullptr);
+            }
+
+            template <class Lock, class Predicate>
+            void wait( Lock& mutex, Predicate pred )
+            {
+                while ( !pred() )
+                    ThreadDetail::waitCondition(&cond, mutex.getNativeHandle(), nullptr);
+            }
+
+            // Returns false on timeout
+            template <class Lock>
+            bool waitFor( Lock& mutex, long time )
             {
-                pthread_mutex_lock(&waiting);
-                pthread_cond_wait(&cond, &waiting);
-                pthread_mutex_unlock(&waiting);
+                timespec deadline = ThreadDetail::getDeadline( time );
+                return ThreadDetail::waitCondition(&cond, mutex.getNativeHandle(), &deadline);
+            }
+
+            // Returns the final value of pred()
+            template <class Lock, class Predicate>
+            bool waitFor( Lock& mutex, long time, Predicate pred )
+            {
+                timespec deadline = ThreadDetail::getDeadline( time );
+
+                while ( !pred() )
+                    if ( !ThreadDetail::waitCondition(&cond, mutex.getNativeHandle(), &deadline) )
+                        return pred();
+
                 return true;
             }
+
+            void set()
+            {
+                event.set();
+            }
+
+            bool waitFor( long time = -1 )
+            {
+                return event.wait( time );
+            }
     };
 
+    // Gives up the rest of the time slice to another ready thread
+    inline void yieldThread()
+    {
+        sched_yield();
+    }
+
+    // Number of processors currently online (at least 1)
+    inline unsigned getNumHardwareThreads()
+    {
+        long count = sysconf( _SC_NPROCESSORS_ONLN );
+        return ( count > 0 ) ? static_cast<unsigned>( count ) : 1;
+    }
+
     inline bool interlockedCompareExchange(volatile int32_t* value_ptr, int32_t compareTo, int32_t newValue)
     {
 #if defined(li_Apple)
@@ -337,34 +337,231 @@ namespace li
             {
                 LeaveCriticalSection( &criticalSection );
             }
+
+            CRITICAL_SECTION* getNativeHandle()
+            {
+                return &criticalSection;
+            }
     };
 
-    class ConditionVar
+    // Non-recursive mutex: cheaper than Mutex, but deadlocks if entered twice by the same thread
+    class FastMutex
+    {
+        SRWLOCK lock;
+
+        FastMutex( const FastMutex& );
+        FastMutex& operator = ( const FastMutex& );
+
+        public:
+            FastMutex()
+            {
+                InitializeSRWLock( &lock );
+            }
+
+            void enter()
+            {
+                AcquireSRWLockExclusive( &lock );
+            }
+
+            bool tryEnter()
+            {
+                return TryAcquireSRWLockExclusive( &lock ) != 0;
+            }
+
+            void leave()
+            {
+                ReleaseSRWLockExclusive( &lock );
+            }
+
+            SRWLOCK* getNativeHandle()
+            {
+                return &lock;
+            }
+    };
+
+    // Reader/writer lock for read-mostly data: any number of threads may hold it shared, or one exclusively
+    class RWLock
+    {
+        SRWLOCK lock;
+
+        RWLock( const RWLock& );
+        RWLock& operator = ( const RWLock& );
+
+        public:
+            RWLock()
+            {
+                InitializeSRWLock( &lock );
+            }
+
+            void enter()
+            {
+                AcquireSRWLockExclusive( &lock );
+            }
+
+            bool tryEnter()
+            {
+                return TryAcquireSRWLockExclusive( &lock ) != 0;
+            }
+
+            void leave()
+            {
+                ReleaseSRWLockExclusive( &lock );
+            }
+
+            void enterShared()
+            {
+                AcquireSRWLockShared( &lock );
+            }
+
+            bool tryEnterShared()
+            {
+                return TryAcquireSRWLockShared( &lock ) != 0;
+            }
+
+            void leaveShared()
+            {
+                ReleaseSRWLockShared( &lock );
+            }
+    };
+
+    // Auto-reset (wakes one waiter, then clears itself) or manual-reset (stays set until reset()) event.
+    // Unlike a bare condition variable it remembers a set() that arrives before anybody waits.
+    class Event
     {
         HANDLE event;
 
+        Event( const Event& );
+        Event& operator = ( const Event& );
+
         public:
-            ConditionVar()
+            Event( bool manualReset = false, bool initialState = false )
             {
-                event = CreateEvent( nullptr, false, false, nullptr );
+                event = CreateEvent( nullptr, manualReset, initialState, nullptr );
             }
 
-            ~ConditionVar()
+            ~Event()
             {
                 CloseHandle( event );
             }
 
+            void reset()
+            {
+                ResetEvent( event );
+            }
+
             void set()
             {
                 SetEvent( event );
             }
 
-            bool waitFor()
+            // Returns false if `time` milliseconds passed without the event being set
+            bool wait( long time = -1 )
             {
-                return WaitForSingleObject( event, INFINITE ) == WAIT_OBJECT_0;
+                return WaitForSingleObject( event, time < 0 ? INFINITE : time ) == WAIT_OBJECT_0;
             }
     };
 
+    // Condition variable used together with a Mutex or FastMutex held by the caller.
+    // (A Mutex must be entered exactly once by the waiting thread, since waiting releases it only once.)
+    //
+    // set() and waitFor() without a mutex behave like an auto-reset Event.
+    class ConditionVar
+    {
+        CONDITION_VARIABLE cond;
+        Event event;
+
+        ConditionVar( const ConditionVar& );
+        ConditionVar& operator = ( const ConditionVar& );
+
+        bool sleep( CRITICAL_SECTION* criticalSection, DWORD time )
+        {
+            return SleepConditionVariableCS( &cond, criticalSection, time ) != 0;
+        }
+
+        bool sleep( SRWLOCK* lock, DWORD time )
+        {
+            return SleepConditionVariableSRW( &cond, lock, time, 0 ) != 0;
+        }
+
+        public:
+            ConditionVar()
+            {
+                InitializeConditionVariable( &cond );
+            }
+
+            void notifyOne()
+            {
+                WakeConditionVariable( &cond );
+            }
+
+            void notifyAll()
+            {
+                WakeAllConditionVariable( &cond );
+            }
+
+            // Releases `mutex` and waits for a notification (or a spurious wakeup), then re-enters it
+            template <class Lock>
+            void wait( Lock& mutex )
+            {
+                sleep( mutex.getNativeHandle(), INFINITE );
+            }
+
+            template <class Lock, class Predicate>
+            void wait( Lock& mutex, Predicate pred )
+            {
+                while ( !pred() )
+                    sleep( mutex.getNativeHandle(), INFINITE );
+            }
+
+            // Returns false on timeout
+            template <class Lock>
+            bool waitFor( Lock& mutex, long time )
+            {
+                return sleep( mutex.getNativeHandle(), time );
+            }
+
+            // Returns the final value of pred()
+            template <class Lock, class Predicate>
+            bool waitFor( Lock& mutex, long time, Predicate pred )
+            {
+                ULONGLONG deadline = GetTickCount64() + time;
+
+                while ( !pred() )
+                {
+                    ULONGLONG now = GetTickCount64();
+
+                    if ( now >= deadline || ( !sleep( mutex.getNativeHandle(), static_cast<DWORD>( deadline - now ) ) && GetLastError() == ERROR_TIMEOUT ) )
+                        return pred();
+                }
+
+                return true;
+            }
+
+            void set()
+            {
+                event.set();
+            }
+
+            bool waitFor( long time = -1 )
+            {
+                return event.wait( time );
+            }
+    };
+
+    // Gives up the rest of the time slice to another ready thread
+    inline void yieldThread()
+    {
+        SwitchToThread();
+    }
+
+    // Number of logical processors in the current processor group (at least 1)
+    inline unsigned getNumHardwareThreads()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        return ( info.dwNumberOfProcessors > 0 ) ? static_cast<unsigned>( info.dwNumberOfProcessors ) : 1;
+    }
+
     inline bool interlockedCompareExchange(volatile int32_t* value_ptr, int32_t compareTo, int32_t newValue)
     {
         return InterlockedCompareExchange((volatile LONG*) value_ptr, newValue, compareTo) == compareTo;
@@ -26,6 +26,23 @@
 
 #include <littl/Algorithm.hpp>
 
+#include <cstdint>
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define li_Utf8_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#define li_Utf8_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 /*
   thanks to the HTML Tidy project (http://sourceforge.net/projects/tidy/)
     for the UTF-8 {en,de}coding code
@@ -33,6 +50,29 @@
 
 namespace li
 {
+    namespace Utf8Detail
+    {
+        inline unsigned countTrailingZeros( uint32_t mask )
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward( &index, mask );
+            return index;
+#else
+            return __builtin_ctz( mask );
+#endif
+        }
+
+#ifdef li_Utf8_SSE2
+        // Sum of the 16 unsigned byte lanes
+        inline size_t sumBytes( __m128i counts )
+        {
+            const __m128i sums = _mm_sad_epu8( counts, _mm_setzero_si128() );
+            return _mm_cvtsi128_si32( sums ) + _mm_cvtsi128_si32( _mm_srli_si128( sums, 8 ) );
+        }
+#endif
+    }
+
 #define li_this Utf8Tpl<dummy_>
 
     template <int dummy_>
@@ -42,6 +82,11 @@ namespace li
             static unsigned int beginDecode( Unicode::Char& c, unsigned char first );
             static size_t decode( Unicode::Char& c, const char* buffer, size_t bufferLength );
 
+            // Bulk-decodes numBytes of UTF-8 into 16- or 32-bit code units (one per code point; no surrogate pairs).
+            // `output` must have room for numBytes + 1 units. Fails on the first malformed sequence.
+            template <typename CharOut>
+            static bool decodeTo( CharOut* output, const char* utf8, size_t numBytes, size_t& numChars_out );
+
             template <typename Allocator>
             static wchar_t* decodeToWideStringAlloc( const char* utf8String, size_t& numChars_out );
 
@@ -49,7 +94,16 @@ namespace li
 
             static unsigned int encode( Unicode::Char c, char* buffer );
             static bool isEmpty( const char* string );
+
+            // Strict RFC 3629 check: no overlong forms, surrogates or code points above U+10FFFF
+            static bool isValid( const char* utf8, size_t numBytes );
+
+            // Number of leading bytes below 0x80
+            static size_t numAsciiBytes( const char* utf8, size_t numBytes );
+
             static size_t numChars( const char* string );
+            static size_t numChars( const char* utf8, size_t numBytes );
+            static size_t validSequenceLength( const char* utf8, size_t numBytes );
     };
 
     typedef Utf8Tpl<0> Utf8;
@@ -123,44 +177,88 @@ namespace li
     }
 
     template <int dummy_>
-    template <typename Allocator>
-    wchar_t* li_this::decodeToWideStringAlloc( const char* utf8String, size_t& numChars_out )
+    template <typename CharOut>
+    bool li_this::decodeTo( CharOut* output, const char* utf8, size_t numBytes, size_t& numChars_out )
     {
-        if ( isEmpty( utf8String ) )
-            return nullptr;
+        static_assert( sizeof( CharOut ) == 2 || sizeof( CharOut ) == 4, "CharOut must be a 16- or 32-bit type" );
 
-        const size_t bytesIn = strlen( utf8String );
+        const unsigned char* in = reinterpret_cast<const unsigned char*>( utf8 );
+        CharOut* out = output;
+        size_t i = 0;
 
-        // Start out conservative
-        size_t bufferSizeInWchars = align<4>( bytesIn / 2 );
+        while ( i < numBytes )
+        {
+#ifdef li_Utf8_SSE2
+            // ASCII runs are widened 16 bytes at a time
+            while ( i + 16 <= numBytes )
+            {
+                const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+
+                if ( _mm_movemask_epi8( bytes ) != 0 )
+                    break;
+
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i lo = _mm_unpacklo_epi8( bytes, zero );
+                const __m128i hi = _mm_unpackhi_epi8( bytes, zero );
+
+                if ( sizeof( CharOut ) == 2 )
+                {
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), lo );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8 ), hi );
+                }
+                else
+                {
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), _mm_unpacklo_epi16( lo, zero ) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4 ), _mm_unpackhi_epi16( lo, zero ) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 8 ), _mm_unpacklo_epi16( hi, zero ) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 12 ), _mm_unpackhi_epi16( hi, zero ) );
+                }
+
+                out += 16;
+                i += 16;
+            }
 
-        wchar_t* buffer = Allocator::allocate( bufferSizeInWchars + 1 );
+            if ( i >= numBytes )
+                break;
+#endif
 
-        numChars_out = 0;
+            if ( in[i] < 0x80 )
+            {
+                *out++ = static_cast<CharOut>( in[i++] );
+                continue;
+            }
 
-        for ( size_t bytesRead = 0; bytesRead < bytesIn; )
-        {
-            UnicodeChar c;
+            Unicode::Char c;
+            const size_t length = decode( c, utf8 + i, numBytes - i );
+
+            if ( length == 0 )
+                return false;
+
+            *out++ = static_cast<CharOut>( c );
+            i += length;
+        }
 
-            unsigned int charLength = beginDecode( c, *utf8String );
+        *out = 0;
+        numChars_out = out - output;
+        return true;
+    }
 
-            if ( bytesRead + charLength > bytesIn )
-                return Allocator::release( buffer ),
-                        nullptr;
+    template <int dummy_>
+    template <typename Allocator>
+    wchar_t* li_this::decodeToWideStringAlloc( const char* utf8String, size_t& numChars_out )
+    {
+        if ( isEmpty( utf8String ) )
+            return nullptr;
 
-            decode( c, utf8String + bytesRead, charLength );
+        const size_t bytesIn = strlen( utf8String );
 
-            if ( numChars_out + 1 > bufferSizeInWchars )
-            {
-                bufferSizeInWchars = bufferSizeInWchars * 3 / 2;
-                buffer = Allocator::resize( buffer, bufferSizeInWchars + 1 );
-            }
+        // Never more characters than bytes
+        wchar_t* buffer = Allocator::allocate( bytesIn + 1 );
 
-            buffer[numChars_out++] = c;
-            bytesRead += charLength;
-        }
+        if ( !decodeTo( buffer, utf8String, bytesIn, numChars_out ) )
+            return Allocator::release( buffer ),
+                    nullptr;
 
-        buffer[numChars_out] = 0;
         return buffer;
     }
 
@@ -170,24 +268,24 @@ namespace li
             return 0;
 
         const size_t bytesIn = strlen( utf8String );
-
         size_t numChars_out = 0;
 
-        for ( size_t bytesRead = 0; bytesRead < bytesIn; )
-        {
-            UnicodeChar c;
+        if ( bufferSizeInWchars > bytesIn )
+            return decodeTo( buffer, utf8String, bytesIn, numChars_out ) ? numChars_out : 0;
 
-            unsigned int charLength = beginDecode( c, *utf8String );
-
-            if ( bytesRead + charLength > bytesIn )
-                return 0;
+        // The buffer might be too small; count first
+        if ( numChars( utf8String, bytesIn ) + 1 > bufferSizeInWchars )
+            return 0;
 
-            decode( c, utf8String + bytesRead, charLength );
+        for ( size_t bytesRead = 0; bytesRead < bytesIn; )
+        {
+            Unicode::Char c;
+            const size_t charLength = decode( c, utf8String + bytesRead, bytesIn - bytesRead );
 
-            if ( numChars_out + 1 > bufferSizeInWchars - 1 )
+            if ( charLength == 0 )
                 return 0;
 
-            buffer[numChars_out++] = c;
+            buffer[numChars_out++] = static_cast<wchar_t>( c );
             bytesRead += charLength;
         }
 
@@ -258,20 +356,163 @@ namespace li
         return !( string && *string );
     }
 
-    li_member( size_t ) numChars( const char* string )
+    li_member( bool ) isValid( const char* utf8, size_t numBytes )
     {
-        size_t length = 0;
+        for ( size_t i = 0; ; )
+        {
+            i += numAsciiBytes( utf8 + i, numBytes - i );
+
+            if ( i == numBytes )
+                return true;
+
+            const size_t length = validSequenceLength( utf8 + i, numBytes - i );
+
+            if ( length == 0 )
+                return false;
+
+            i += length;
+        }
+    }
 
+    li_member( size_t ) numAsciiBytes( const char* utf8, size_t numBytes )
+    {
+        size_t i = 0;
+
+#if defined( li_Utf8_AVX2 )
+        for ( ; i + 32 <= numBytes; i += 32 )
+        {
+            const uint32_t mask = _mm256_movemask_epi8( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( utf8 + i ) ) );
+
+            if ( mask != 0 )
+                return i + Utf8Detail::countTrailingZeros( mask );
+        }
+#endif
+
+#if defined( li_Utf8_SSE2 )
+        for ( ; i + 16 <= numBytes; i += 16 )
+        {
+            const uint32_t mask = _mm_movemask_epi8( _mm_loadu_si128( reinterpret_cast<const __m128i*>( utf8 + i ) ) );
+
+            if ( mask != 0 )
+                return i + Utf8Detail::countTrailingZeros( mask );
+        }
+#else
+        for ( ; i + 8 <= numBytes; i += 8 )
+        {
+            uint64_t word;
+            memcpy( &word, utf8 + i, 8 );
+
+            if ( word & 0x8080808080808080ULL )
+                break;
+        }
+#endif
+
+        while ( i < numBytes && static_cast<unsigned char>( utf8[i] ) < 0x80 )
+            i++;
+
+        return i;
+    }
+
+    li_member( size_t ) numChars( const char* string )
+    {
         if ( !string )
             return 0;
 
-        for ( size_t i = 0; string[i]; i++ )
-            if ( ( string[i] & 0xC0 ) != 0x80 )
+        return numChars( string, strlen( string ) );
+    }
+
+    li_member( size_t ) numChars( const char* utf8, size_t numBytes )
+    {
+        // Every byte except continuation bytes (10xxxxxx) begins a character
+        size_t length = 0, i = 0;
+
+#if defined( li_Utf8_AVX2 )
+        const __m256i threshold256 = _mm256_set1_epi8( -65 );
+
+        for ( ; i + 32 <= numBytes; i += 32 )
+        {
+            const __m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( utf8 + i ) );
+            const uint32_t mask = _mm256_movemask_epi8( _mm256_cmpgt_epi8( bytes, threshold256 ) );
+
+            // Count set bits
+            uint32_t v = mask - ( ( mask >> 1 ) & 0x55555555 );
+            v = ( v & 0x33333333 ) + ( ( v >> 2 ) & 0x33333333 );
+            length += ( ( ( v + ( v >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24;
+        }
+#endif
+
+#if defined( li_Utf8_SSE2 )
+        // Per-lane counters can take 255 blocks before overflowing
+        const __m128i threshold = _mm_set1_epi8( -65 );
+
+        while ( i + 16 <= numBytes )
+        {
+            __m128i counts = _mm_setzero_si128();
+
+            for ( unsigned block = 0; block < 255 && i + 16 <= numBytes; block++, i += 16 )
+            {
+                const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>( utf8 + i ) );
+                counts = _mm_sub_epi8( counts, _mm_cmpgt_epi8( bytes, threshold ) );
+            }
+
+            length += Utf8Detail::sumBytes( counts );
+        }
+#endif
+
+        for ( ; i < numBytes; i++ )
+            if ( ( utf8[i] & 0xC0 ) != 0x80 )
                 length++;
 
         return length;
     }
 
+    li_member( size_t ) validSequenceLength( const char* utf8, size_t numBytes )
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>( utf8 );
+
+        if ( numBytes == 0 )
+            return 0;
+
+        if ( p[0] < 0x80 )
+            return 1;
+
+        // Bounds for the second byte exclude overlong forms, surrogates and code points above U+10FFFF
+        size_t length;
+        unsigned char min = 0x80, max = 0xBF;
+
+        if ( p[0] >= 0xC2 && p[0] <= 0xDF )
+            length = 2;
+        else if ( p[0] >= 0xE0 && p[0] <= 0xEF )
+        {
+            length = 3;
+
+            if ( p[0] == 0xE0 )
+                min = 0xA0;
+            else if ( p[0] == 0xED )
+                max = 0x9F;
+        }
+        else if ( p[0] >= 0xF0 && p[0] <= 0xF4 )
+        {
+            length = 4;
+
+            if ( p[0] == 0xF0 )
+                min = 0x90;
+            else if ( p[0] == 0xF4 )
+                max = 0x8F;
+        }
+        else
+            return 0;
+
+        if ( length > numBytes || p[1] < min || p[1] > max )
+            return 0;
+
+        for ( size_t i = 2; i < length; i++ )
+            if ( ( p[i] & 0xC0 ) != 0x80 )
+                return 0;
+
+        return length;
+    }
+
 #undef li_member
 
 #undef li_this